@@ -0,0 +1,176 @@
+#include "../TimeSeriesTransformations/TimeSeriesTransformations.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <memory_resource>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+// Synthetic series split into one (time, price) pair of vectors per day
+struct DaySlices {
+    std::vector<std::vector<int>> times;
+    std::vector<std::vector<double>> prices;
+};
+
+// Build `days` days of data sampled every `interval` seconds with a random walk price
+DaySlices makeDaySlices(int days, int interval) {
+    std::mt19937 generator(42);
+    std::normal_distribution<double> step(0.0, 1.0);
+
+    DaySlices slices;
+    double price = 50.0;
+    int start = 1619049600; // 2021-04-22 00:00:00
+    for (int day = 0; day < days; ++day) {
+        std::vector<int> time;
+        std::vector<double> prices;
+        for (int t = 0; t < 86400; t += interval) {
+            time.push_back(start + day * 86400 + t);
+            price += step(generator);
+            prices.push_back(price);
+        }
+        slices.times.push_back(time);
+        slices.prices.push_back(prices);
+    }
+    return slices;
+}
+
+// Time `rounds` passes of building and destroying one series per day, returning nanoseconds per slice
+template <typename MakeSeries>
+double timeSlices(const DaySlices& slices, int rounds, MakeSeries makeSeries) {
+    long long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int round = 0; round < rounds; ++round) {
+        for (size_t day = 0; day < slices.times.size(); ++day) {
+            checksum += makeSeries(slices.times[day], slices.prices[day]);
+        }
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if (checksum == 0) {
+        std::cout << "(empty slices)" << std::endl;
+    }
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (static_cast<double>(rounds) * slices.times.size());
+}
+
+// Compare per-day slice construction with the default allocator, a monotonic arena and a pool
+void benchmarkDaySlices() {
+    const int days = 5000;
+    const int rounds = 40;
+    DaySlices slices = makeDaySlices(days, 5000);
+
+    double defaultNs = timeSlices(slices, rounds, [](const std::vector<int>& time, const std::vector<double>& price) {
+        TimeSeriesTransformations ts(time, price, "ShareX-intraday-slice");
+        return ts.count();
+    });
+
+    // Arena reused for every slice, released after each one
+    std::vector<char> arenaBuffer(1 << 16);
+    std::pmr::monotonic_buffer_resource arena(arenaBuffer.data(), arenaBuffer.size(), std::pmr::null_memory_resource());
+    double arenaNs = timeSlices(slices, rounds, [&arena](const std::vector<int>& time, const std::vector<double>& price) {
+        int count;
+        {
+            TimeSeriesTransformations ts(time, price, "ShareX-intraday-slice", &arena);
+            count = ts.count();
+        }
+        arena.release();
+        return count;
+    });
+
+    std::pmr::unsynchronized_pool_resource pool;
+    double poolNs = timeSlices(slices, rounds, [&pool](const std::vector<int>& time, const std::vector<double>& price) {
+        TimeSeriesTransformations ts(time, price, "ShareX-intraday-slice", &pool);
+        return ts.count();
+    });
+
+    std::cout << "Per-day slices (" << days << " days x " << rounds << " rounds, "
+              << slices.times[0].size() << " samples per day)" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  default allocator: " << defaultNs << " ns/slice" << std::endl;
+    std::cout << "  monotonic arena:   " << arenaNs << " ns/slice" << std::endl;
+    std::cout << "  pool resource:     " << poolNs << " ns/slice" << std::endl;
+}
+
+// Measure t-digest rank error against exact quantiles, and sketch throughput on one and several threads
+void benchmarkQuantileSketches() {
+    const size_t n = 4000000;
+    std::mt19937 generator(7);
+    std::student_t_distribution<double> heavyTailed(3.0);
+    std::vector<double> values(n);
+    for (double& value : values) {
+        value = heavyTailed(generator);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    TDigest digest;
+    for (double value : values) {
+        digest.add(value);
+    }
+    double digestSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Build one digest per thread over a quarter of the values each, then merge
+    const size_t threads = 4;
+    start = std::chrono::steady_clock::now();
+    std::vector<TDigest> partial(threads);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (size_t i = t * n / threads; i < (t + 1) * n / threads; ++i) {
+                partial[t].add(values[i]);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    TDigest merged;
+    for (const auto& part : partial) {
+        merged.merge(part);
+    }
+    double mergedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    Histogram histogram(-10.0, 10.0, 2000);
+    for (double value : values) {
+        histogram.add(value);
+    }
+    double histogramSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> sorted(values);
+    start = std::chrono::steady_clock::now();
+    std::sort(sorted.begin(), sorted.end());
+    double sortSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Rank error: how far the estimate's true rank is from the requested one
+    auto rankError = [&sorted](double estimate, double q) {
+        double rank = static_cast<double>(std::lower_bound(sorted.begin(), sorted.end(), estimate) - sorted.begin());
+        return std::fabs(rank / sorted.size() - q);
+    };
+
+    std::cout << "Quantile sketches (" << n << " Student-t values)" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  t-digest add:       " << n / digestSeconds / 1e6 << " M values/s" << std::endl;
+    std::cout << "  t-digest " << threads << " threads + merge: " << n / mergedSeconds / 1e6 << " M values/s" << std::endl;
+    std::cout << "  histogram add:      " << n / histogramSeconds / 1e6 << " M values/s" << std::endl;
+    std::cout << "  full sort:          " << n / sortSeconds / 1e6 << " M values/s" << std::endl;
+    std::cout << std::setprecision(6);
+    for (double q : {0.001, 0.01, 0.05, 0.5, 0.95, 0.99, 0.999}) {
+        std::cout << "  q=" << q << " rank error: digest " << rankError(digest.quantile(q), q)
+                  << ", merged " << rankError(merged.quantile(q), q) << ", histogram ";
+        // The histogram has no estimate for quantiles outside its bins
+        double estimate = histogram.quantile(q);
+        if (std::isnan(estimate)) {
+            std::cout << "n/a (outside bins)" << std::endl;
+        } else {
+            std::cout << rankError(estimate, q) << std::endl;
+        }
+    }
+}
+
+int main() {
+    benchmarkDaySlices();
+    benchmarkQuantileSketches();
+    return 0;
+}
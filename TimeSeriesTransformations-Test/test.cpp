@@ -1,7 +1,12 @@
 #include "../TimeSeriesTransformations/TimeSeriesTransformations.h"
+#include "../TimeSeriesTransformations/DiskBackedTimeSeries.h"
+#include "../TimeSeriesTransformations/ThreadPool.h"
 #include <iostream>
 #include <cassert>
 #include <fstream>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
 
 // Helper function to compare doubles with a tolerance
 bool almostEqual(double a, double b, double tolerance = 1e-5) {
@@ -38,6 +43,34 @@ void testConstructorWithVectors() {
     std::cout << "testConstructorWithVectors passed!" << std::endl;
 }
 
+// Test the constructors that allocate from a memory resource
+void testConstructorWithMemoryResource() {
+    std::vector<int> time = {3, 1, 2};
+    std::vector<double> price = {12.5, 10.5, 11.5};
+    char buffer[16384];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+    TimeSeriesTransformations ts(time, price, "A name too long for the small string buffer", &arena);
+    assert(ts.getResource() == &arena);
+    assert(ts.count() == 3);
+    assert(ts.getName() == "A name too long for the small string buffer");
+    assert(almostEqual(ts.getPrice()[0], 10.5));
+
+    // Everything derived from the data allocates from the series' resource, not the default one
+    std::pmr::memory_resource* previousDefault = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+    double median;
+    ts.addASharePrice("2021-04-23 13:36:50", 13.5);
+    assert(ts.priceQuantile(0.5, &median) && ts.getFeatureHistory().count() == 4);
+    assert(ts.removePricesGreaterThan(13.0) && ts.priceQuantile(0.5, &median) && ts.getFeatures().count() == 3);
+    std::pmr::set_default_resource(previousDefault);
+
+    // Copies use the default resource unless one is given
+    TimeSeriesTransformations copy(ts);
+    assert(copy.getResource() == std::pmr::get_default_resource());
+    assert(copy == ts);
+    std::cout << "testConstructorWithMemoryResource passed!" << std::endl;
+}
+
 // Test the copy constructor
 void testCopyConstructor() {
     std::vector<int> time = {1, 2, 3};
@@ -337,6 +370,18 @@ void testGetPriceAtDate() {
 
     assert(success);
     assert(price > 0.0);
+
+    // The first entry at each time is found; times between entries are not
+    for (size_t i = 1; i + 1 < times.size(); i += 997) {
+        if (times[i] != times[i - 1]) {
+            assert(ts.getPriceAtDate(TimeSeriesTransformations::unixToDateTime(times[i]), &price));
+            assert(price == prices[i]);
+        }
+        if (times[i + 1] > times[i] + 1) {
+            assert(!ts.getPriceAtDate(TimeSeriesTransformations::unixToDateTime(times[i] + 1), &price));
+            assert(std::isnan(price));
+        }
+    }
    // std::cout << "testGetPriceAtDate passed!" << std::endl;
 }
 
@@ -350,13 +395,627 @@ void testSaveData() {
     std::cout << "testSaveData passed!" << std::endl;
 }
 
+// Test the saveData() overload with precision and ISO timestamp options
+void testSaveDataWithOptions() {
+    std::vector<int> time = {1619125010, 1619120010};
+    std::vector<double> price = {58.74815, 61.43814};
+    TimeSeriesTransformations ts(time, price, "ShareX");
+
+    ts.saveData("test_output_options", 7, true);
+    std::ifstream file("test_output_options.csv");
+    std::string header, first, second;
+    std::getline(file, header);
+    std::getline(file, first);
+    std::getline(file, second);
+
+    assert(header == "Unix-TIME SERIES DATA: ShareX");
+    assert(first == "2021-04-22 19:33:30,61.43814");
+    assert(second == "2021-04-22 20:56:50,58.74815");
+    std::cout << "testSaveDataWithOptions passed!" << std::endl;
+}
+
+// Test the loadAsync() function against the file constructor
+void testLoadAsync() {
+    std::ofstream csv("test_async_input.csv");
+    csv << "TIMESTAMP,ShareX\n1619125010,58.74814841\n1619120010,61.43814038\n1619130010,90.10017163";
+    csv.close();
+
+    size_t lastDone = 0, lastTotal = 0;
+    auto future = TimeSeriesTransformations::loadAsync("test_async_input.csv",
+        [&](size_t done, size_t total) { lastDone = done; lastTotal = total; });
+    TimeSeriesTransformations ts = future.get();
+
+    assert(ts == TimeSeriesTransformations("test_async_input.csv"));
+    assert(ts.getName() == "ShareX");
+    assert(ts.count() == 3);
+    assert(lastDone > 0 && lastDone == lastTotal);
+    std::cout << "testLoadAsync passed!" << std::endl;
+}
+
+// Test cancelling a loadAsync() call
+void testLoadAsyncCancelled() {
+    auto cancel = std::make_shared<std::atomic<bool>>(true);
+    auto future = TimeSeriesTransformations::loadAsync("test_async_input.csv", nullptr, cancel);
+
+    bool threw = false;
+    try {
+        future.get();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    std::cout << "testLoadAsyncCancelled passed!" << std::endl;
+}
+
+// Test the saveDataAsync() function
+void testSaveDataAsync() {
+    std::vector<int> time = {1, 2, 3};
+    std::vector<double> price = {10.5, 11.5, 12.5};
+    TimeSeriesTransformations ts(time, price, "TestSeries");
+
+    size_t rowsWritten = 0;
+    auto future = ts.saveDataAsync("test_output_async", [&](size_t done, size_t) { rowsWritten = done; });
+    ts.removePricesGreaterThan(11.0); // Does not affect the snapshot being saved
+    future.get();
+
+    std::ifstream file("test_output_async.csv");
+    std::string header, line;
+    std::getline(file, header);
+    int rows = 0;
+    while (std::getline(file, line)) {
+        ++rows;
+    }
+    assert(rows == 3);
+    assert(rowsWritten == 3);
+    std::cout << "testSaveDataAsync passed!" << std::endl;
+}
+
+// Test view() against copying the series and filtering it
+void testView() {
+    std::vector<int> time;
+    std::vector<double> price;
+    for (int i = 0; i < 100; ++i) {
+        time.push_back(1619120010 + i * 5000);
+        price.push_back(50.0 + (i * 37 % 23) - (i % 5) * 1.5);
+    }
+    TimeSeriesTransformations ts(time, price, "ShareX");
+
+    TimeSeriesTransformations filtered(ts);
+    filtered.removePricesBefore("2021-04-23 00:00:00");
+    filtered.removePricesAfter("2021-04-24 12:00:00");
+    SeriesView view = ts.view("2021-04-23 00:00:00", "2021-04-24 12:00:00");
+
+    assert(view.count() == filtered.count());
+    assert(view.getTime() == filtered.getTime());
+    assert(view.getIncrements() == filtered.getIncrements());
+
+    double expected, actual;
+    filtered.mean(&expected);
+    assert(view.mean(&actual) && actual == expected);
+    filtered.standardDeviation(&expected);
+    assert(view.standardDeviation(&actual) && actual == expected);
+    filtered.computeIncrementMean(&expected);
+    assert(view.computeIncrementMean(&actual) && actual == expected);
+    filtered.computeIncrementStandardDeviation(&expected);
+    assert(view.computeIncrementStandardDeviation(&actual) && actual == expected);
+
+    std::string expectedDate, actualDate;
+    filtered.findGreatestIncrements(&expectedDate, &expected);
+    assert(view.findGreatestIncrements(&actualDate, &actual));
+    assert(actualDate == expectedDate && actual == expected);
+
+    // Prices outside the view are not found through it
+    assert(ts.getPriceAtDate("2021-04-22 19:33:30", &expected));
+    assert(!view.getPriceAtDate("2021-04-22 19:33:30", &actual));
+    assert(view.getPriceAtDate("2021-04-23 13:36:50", &actual) && actual == price[13]);
+
+    assert(view.toSeries() == filtered);
+    std::cout << "testView passed!" << std::endl;
+}
+
+// Test viewOnDate()
+void testViewOnDate() {
+    std::vector<int> time = {1619049599, 1619049600, 1619100000, 1619135999, 1619136000};
+    std::vector<double> price = {1.0, 2.0, 3.0, 4.0, 5.0};
+    TimeSeriesTransformations ts(time, price, "TestSeries");
+
+    SeriesView day = ts.viewOnDate("2021-04-22");
+    assert(day.count() == 3);
+    assert(day.getPrice() == std::vector<double>({2.0, 3.0, 4.0}));
+
+    double meanValue;
+    assert(!ts.viewOnDate("2020-01-01").mean(&meanValue));
+    std::cout << "testViewOnDate passed!" << std::endl;
+}
+
+// Test that range statistics from the block summaries track changes to the series
+void testBlockSummaryRangeStatistics() {
+    std::vector<int> time;
+    std::vector<double> price;
+    for (int i = 0; i < 20000; ++i) {
+        time.push_back(1600000000 + i * 60);
+        price.push_back(100.0 + std::sin(i * 0.01) * 20.0 + (i % 7) * 0.25);
+    }
+    TimeSeriesTransformations ts(time, price, "ShareX");
+    ts.addASharePrice("2020-09-14 00:00:30", 250.0);
+    ts.removePricesGreaterThan(119.0);
+    ts.removeEntryAtTime("2020-09-13 12:26:40");
+
+    TimeSeriesTransformations filtered(ts);
+    filtered.removePricesBefore("2020-09-13 16:00:00");
+    filtered.removePricesAfter("2020-09-24 08:00:00");
+    SeriesView view = ts.view("2020-09-13 16:00:00", "2020-09-24 08:00:00");
+    assert(view.count() == filtered.count());
+
+    auto relativelyEqual = [](double a, double b) { return std::fabs(a - b) <= 1e-9 * std::fabs(b); };
+    double expected, actual;
+    filtered.mean(&expected);
+    assert(view.mean(&actual) && relativelyEqual(actual, expected));
+    filtered.standardDeviation(&expected);
+    assert(view.standardDeviation(&actual) && relativelyEqual(actual, expected));
+    filtered.computeIncrementMean(&expected);
+    assert(view.computeIncrementMean(&actual) && relativelyEqual(actual, expected));
+    filtered.computeIncrementStandardDeviation(&expected);
+    assert(view.computeIncrementStandardDeviation(&actual) && relativelyEqual(actual, expected));
+
+    // Appends across a block boundary, folded into the tail, match summaries built in one pass
+    for (double& p : price) {
+        p = std::round(p * 1e5) / 1e5; // As addASharePrice rounds
+    }
+    std::vector<int> firstTime(time.begin(), time.begin() + 4090);
+    std::vector<double> firstPrice(price.begin(), price.begin() + 4090);
+    TimeSeriesTransformations appended(firstTime, firstPrice, "ShareX");
+    uint64_t before = appended.hash(); // Builds the summaries, which the appends then update
+    for (size_t i = 4090; i < 4110; ++i) {
+        appended.addASharePrice(TimeSeriesTransformations::unixToDateTime(time[i]), price[i]);
+    }
+    TimeSeriesTransformations built(std::vector<int>(time.begin(), time.begin() + 4110),
+        std::vector<double>(price.begin(), price.begin() + 4110), "ShareX");
+    assert(appended.hash() == built.hash() && appended.hash() != before);
+    built.standardDeviation(&expected);
+    assert(appended.standardDeviation(&actual) && relativelyEqual(actual, expected));
+    built.computeIncrementStandardDeviation(&expected);
+    assert(appended.computeIncrementStandardDeviation(&actual) && relativelyEqual(actual, expected));
+    SeriesView tail = appended.view(TimeSeriesTransformations::unixToDateTime(time[4096]),
+        TimeSeriesTransformations::unixToDateTime(time[4109]));
+    built.view(TimeSeriesTransformations::unixToDateTime(time[4096]),
+        TimeSeriesTransformations::unixToDateTime(time[4109])).mean(&expected);
+    assert(tail.count() == 14 && tail.mean(&actual) && relativelyEqual(actual, expected));
+    std::cout << "testBlockSummaryRangeStatistics passed!" << std::endl;
+}
+
+// Test range greatest-increment queries against a scan of the increments, as the series changes
+void testGreatestIncrementInRange() {
+    std::vector<int> time;
+    std::vector<double> price;
+    for (int i = 0; i < 3000; ++i) {
+        time.push_back(1600000000 + i * 60);
+        price.push_back(static_cast<double>((i * 7919) % 1000) / 10.0);
+    }
+    TimeSeriesTransformations ts(time, price, "ShareX");
+
+    auto check = [&ts]() {
+        std::vector<int> times = ts.getTime();
+        std::vector<double> increments = ts.getIncrements();
+        for (size_t first = 0; first < times.size(); first += 97) {
+            for (size_t last = first; last <= times.size(); last += 131) {
+                SeriesView view(ts, first, last);
+                int maxTime;
+                double maxIncrement;
+                bool found = view.findGreatestIncrements(&maxTime, &maxIncrement);
+
+                if (last - first < 2) {
+                    assert(!found);
+                    continue;
+                }
+                auto expected = std::max_element(increments.begin() + first, increments.begin() + last - 1);
+                assert(found);
+                assert(maxIncrement == *expected);
+                assert(maxTime == times[expected - increments.begin()]);
+            }
+        }
+    };
+
+    check();
+    ts.addASharePrice("2020-09-15 15:00:00", 500.0); // Appended
+    ts.addASharePrice("2020-09-13 20:00:30", 400.0); // Inserted in the middle
+    check();
+    ts.removePricesGreaterThan(90.0);
+    ts.removePricesAfter("2020-09-14 20:00:00");
+    check();
+
+    std::string date;
+    double increment;
+    assert(ts.findGreatestIncrements(&date, &increment));
+    std::cout << "testGreatestIncrementInRange passed!" << std::endl;
+}
+
+// Test that the parallel execution policies match the sequential results
+void testExecutionPolicies() {
+    using Policy = TimeSeriesTransformations::ExecutionPolicy;
+    std::vector<int> time;
+    std::vector<double> price;
+    for (int i = 0; i < 300000; ++i) {
+        time.push_back(1600000000 + i * 60);
+        price.push_back(50.0 + std::sin(i * 0.001) * 30.0 + (i % 13) * 0.1);
+    }
+    TimeSeriesTransformations ts(time, price, "ShareX");
+
+    auto relativelyEqual = [](double a, double b) { return std::fabs(a - b) <= 1e-12 * std::fabs(b); };
+    for (Policy policy : {Policy::Parallel, Policy::ParallelUnsequenced}) {
+        double expected, actual;
+        ts.mean(&expected);
+        assert(ts.mean(policy, &actual) && relativelyEqual(actual, expected));
+        ts.standardDeviation(&expected);
+        assert(ts.standardDeviation(policy, &actual) && relativelyEqual(actual, expected));
+        ts.computeIncrementMean(&expected);
+        assert(ts.computeIncrementMean(policy, &actual) && std::fabs(actual - expected) <= 1e-15);
+        ts.computeIncrementStandardDeviation(&expected);
+        assert(ts.computeIncrementStandardDeviation(policy, &actual) && relativelyEqual(actual, expected));
+        assert(ts.getIncrements(policy) == ts.getIncrements());
+
+        TimeSeriesTransformations sequential(ts), parallel(ts);
+        assert(sequential.removePricesGreaterThan(70.0) == parallel.removePricesGreaterThan(policy, 70.0));
+        assert(sequential.removePricesLowerThan(30.0) == parallel.removePricesLowerThan(policy, 30.0));
+        assert(sequential.removePricesBefore("2020-09-14 00:00:00") ==
+            parallel.removePricesBefore(policy, "2020-09-14 00:00:00"));
+        assert(sequential.removePricesAfter("2020-11-01 00:00:00") ==
+            parallel.removePricesAfter(policy, "2020-11-01 00:00:00"));
+        assert(!parallel.removePricesAfter(policy, "2021-01-01 00:00:00"));
+        assert(parallel == sequential);
+    }
+
+    TimeSeriesTransformations empty;
+    double value;
+    assert(!empty.mean(Policy::Parallel, &value) && std::isnan(value));
+    std::cout << "testExecutionPolicies passed!" << std::endl;
+}
+
+// Test price and increment quantiles from the sketches kept during ingestion
+void testQuantiles() {
+    std::vector<int> time;
+    std::vector<double> price;
+    for (int i = 0; i < 10001; ++i) {
+        time.push_back(1600000000 + i * 60);
+        price.push_back((i * 7919) % 10001 / 100.0); // Every value 0.00 .. 100.00 once
+    }
+    TimeSeriesTransformations ts(time, price, "ShareX");
+
+    double median, p99;
+    assert(ts.priceQuantile(0.5, &median) && std::fabs(median - 50.0) < 0.1);
+    assert(ts.priceQuantile(0.99, &p99) && std::fabs(p99 - 99.0) < 0.1);
+    assert(ts.priceQuantile(0.0, &median) && median == 0.0);
+    assert(!ts.priceQuantile(1.5, &median));
+
+    // Appending keeps the sketch in step with the data
+    ts.addASharePrice("2020-09-21 00:00:00", 1000.0);
+    double maximum;
+    assert(ts.priceQuantile(1.0, &maximum) && maximum == 1000.0);
+
+    // An insert in the middle adds its price to the sketch; the increment sketch is rebuilt
+    ts.addASharePrice("2020-09-10 00:00:30", 2000.0);
+    assert(ts.priceQuantile(1.0, &maximum) && maximum == 2000.0);
+    assert(ts.getIncrementSketch().count() == static_cast<size_t>(ts.count() - 1));
+
+    // Removals rebuild it on the next query, also in copies that shared the stale storage
+    ts.removePricesGreaterThan(50.0);
+    TimeSeriesTransformations copy(ts);
+    assert(copy.priceQuantile(1.0, &maximum) && maximum <= 50.0);
+    assert(ts.priceQuantile(1.0, &maximum) && maximum <= 50.0);
+    assert(ts.getPriceSketch().count() == static_cast<size_t>(ts.count()));
+    assert(ts.getIncrementSketch().count() == static_cast<size_t>(ts.count() - 1));
+
+    double var;
+    std::vector<double> increments = ts.getIncrements();
+    std::sort(increments.begin(), increments.end());
+    assert(ts.valueAtRisk(0.95, &var));
+    assert(std::fabs(-var - increments[increments.size() / 20]) < 1.0);
+
+    TimeSeriesTransformations empty;
+    assert(!empty.priceQuantile(0.5, &median) && std::isnan(median));
+    std::cout << "testQuantiles passed!" << std::endl;
+}
+
+// Test merging t-digests built separately
+void testTDigestMerge() {
+    TDigest low, high, all;
+    for (int i = 0; i < 50000; ++i) {
+        double value = i / 1000.0;
+        (i % 2 == 0 ? low : high).add(value);
+        all.add(value);
+    }
+    low.merge(high);
+
+    assert(low.count() == all.count());
+    assert(low.min() == 0.0 && low.max() == 49.999);
+    for (double q : {0.01, 0.25, 0.5, 0.75, 0.99}) {
+        assert(std::fabs(low.quantile(q) - q * 50.0) < 0.05);
+    }
+    assert(std::fabs(low.cdf(25.0) - 0.5) < 0.001);
+
+    // Merging a digest into itself doubles every weight
+    double median = all.quantile(0.5);
+    all.merge(all);
+    assert(all.count() == 100000);
+    assert(std::fabs(all.quantile(0.5) - median) < 0.05);
+    std::cout << "testTDigestMerge passed!" << std::endl;
+}
+
+// Test the fixed-bin histograms
+void testHistogram() {
+    std::vector<int> time = {1, 2, 3, 4, 5, 6};
+    std::vector<double> price = {5.0, 15.0, 15.0, 25.0, 95.0, 150.0};
+    TimeSeriesTransformations ts(time, price, "TestSeries");
+
+    Histogram histogram = ts.priceHistogram(0.0, 100.0, 10);
+    assert(histogram.count() == 6);
+    assert(histogram.countInBin(0) == 1);
+    assert(histogram.countInBin(1) == 2);
+    assert(histogram.countInBin(9) == 1);
+    assert(histogram.overflow() == 1);
+    assert(almostEqual(histogram.binLower(2), 20.0));
+
+    Histogram other(0.0, 100.0, 10);
+    other.add(-1.0);
+    histogram.merge(other);
+    assert(histogram.underflow() == 1 && histogram.count() == 7);
+
+    bool threw = false;
+    try {
+        histogram.merge(Histogram(0.0, 50.0, 10));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    std::cout << "testHistogram passed!" << std::endl;
+}
+
+// Test that the out-of-core series gives the same answers as the in-memory one
+void testDiskBackedTimeSeries() {
+    // 3000 prices every 100 seconds from 2021-04-22 00:00:10, written out of order for the external sort
+    std::ofstream csv("test_disk_input.csv");
+    csv << "TIMESTAMP,ShareX";
+    for (int i = 0; i < 3000; ++i) {
+        int row = i * 7 % 3000;
+        csv << '\n' << 1619049610 + 100 * row << ',' << 65.0 + 25.0 * std::sin(row * 0.01) + row % 13 * 0.01;
+    }
+    csv.close();
+
+    TimeSeriesTransformations ts("test_disk_input.csv");
+    std::filesystem::remove_all("test_disk_store");
+    DiskBackedTimeSeries store = DiskBackedTimeSeries::create("test_disk_input.csv", "test_disk_store", 250, 3);
+
+    assert(store.count() == ts.count());
+    assert(store.getName() == ts.getName());
+    assert(store.segmentCount() == static_cast<size_t>(ts.count() + 249) / 250);
+
+    double expected, actual;
+    ts.mean(&expected);
+    assert(store.mean(&actual) && actual == expected);
+    ts.standardDeviation(&expected);
+    assert(store.standardDeviation(&actual) && actual == expected);
+    ts.getPriceAtDate("2021-04-23 13:36:50", &expected);
+    assert(store.getPriceAtDate("2021-04-23 13:36:50", &actual) && actual == expected);
+    assert(!store.getPriceAtDate("1990-01-01 00:00:00", &actual) && std::isnan(actual));
+    assert(store.printSharePricesOnDate("2021-04-23") == ts.printSharePricesOnDate("2021-04-23"));
+    assert(store.printIncrementsOnDate("2021-04-23") == ts.printIncrementsOnDate("2021-04-23"));
+
+    // Filters rewrite only the segments they touch, and the store reopens with the result
+    assert(store.removePricesBefore("2021-04-23 00:00:00") == ts.removePricesBefore("2021-04-23 00:00:00"));
+    assert(store.removePricesGreaterThan(80.0) == ts.removePricesGreaterThan(80.0));
+    assert(!store.removePricesGreaterThan(80.0));
+    assert(store.removeEntryAtTime("2021-04-23 23:13:30") && ts.removeEntryAtTime("2021-04-23 23:13:30"));
+    assert(!store.removeEntryAtTime("2021-04-23 23:13:30"));
+    assert(!store.removeEntryAtTime("2021-04-23 23:13:35"));
+    assert(store.count() == ts.count());
+
+    DiskBackedTimeSeries reopened("test_disk_store", 1);
+    assert(reopened.count() == ts.count());
+    reopened.mean(&actual);
+    ts.mean(&expected);
+    assert(actual == expected);
+    assert(reopened.toSeries("2021-04-23 00:00:00", "2037-12-31 00:00:00") == ts);
+    std::cout << "testDiskBackedTimeSeries passed!" << std::endl;
+}
+
+// Test that copies share their data until one of them changes
+void testCopyOnWrite() {
+    std::vector<int> time = {1, 2, 3};
+    std::vector<double> price = {10.5, 11.5, 12.5};
+    TimeSeriesTransformations ts1(time, price, "TestSeries");
+    TimeSeriesTransformations ts2(ts1);
+    TimeSeriesTransformations ts3;
+    ts3 = ts1;
+    assert(ts2.sharesDataWith(ts1) && ts3.sharesDataWith(ts1));
+
+    // A filter that removes nothing does not copy
+    assert(!ts2.removePricesGreaterThan(20.0));
+    assert(ts2.sharesDataWith(ts1));
+
+    assert(ts2.removePricesGreaterThan(11.0));
+    assert(!ts2.sharesDataWith(ts1) && ts3.sharesDataWith(ts1));
+    assert(ts1.count() == 3 && ts2.count() == 1);
+    double value;
+    assert(ts1.priceQuantile(1.0, &value) && almostEqual(value, 12.5));
+    assert(ts2.priceQuantile(1.0, &value) && almostEqual(value, 10.5));
+
+    ts3.addASharePrice("2021-04-23 13:36:50", 13.5);
+    assert(ts3.count() == 4 && ts1.count() == 3);
+
+    // Filtering shared data leaves summaries matching a series built from the kept entries
+    TimeSeriesTransformations ts5(ts3);
+    assert(ts5.removePricesLowerThan(11.0) && !ts5.sharesDataWith(ts3) && ts3.count() == 4);
+    TimeSeriesTransformations kept({2, 3, ts5.getTime().back()}, {11.5, 12.5, 13.5}, "TestSeries");
+    assert(ts5 == kept && ts5.hash() == kept.hash());
+    assert(ts5.mean(&value) && almostEqual(value, 12.5));
+
+    // Copies into a different resource always copy the data
+    std::pmr::monotonic_buffer_resource arena;
+    TimeSeriesTransformations ts4(ts1, &arena);
+    assert(!ts4.sharesDataWith(ts1) && ts4 == ts1);
+    std::cout << "testCopyOnWrite passed!" << std::endl;
+}
+
+// Test the content hash and diff()
+void testHashAndDiff() {
+    std::vector<int> time;
+    std::vector<double> price;
+    for (int i = 0; i < 10000; ++i) {
+        time.push_back(1619000000 + 5000 * i);
+        price.push_back(50.0 + (i % 97) * 0.25);
+    }
+    TimeSeriesTransformations ts1(time, price, "A");
+
+    // The hash depends on the entries only, however the series was built or changed
+    std::vector<int> reversedTime(time.rbegin(), time.rend());
+    std::vector<double> reversedPrice(price.rbegin(), price.rend());
+    TimeSeriesTransformations ts2(reversedTime, reversedPrice, "B");
+    assert(ts1.hash() == ts2.hash() && ts1 == ts2);
+
+    ts2.removePricesGreaterThan(70.0);
+    assert(ts1.hash() != ts2.hash() && !(ts1 == ts2));
+    std::vector<int> keptTime = ts2.getTime();
+    std::vector<double> keptPrice = ts2.getPrice();
+    assert(TimeSeriesTransformations(keptTime, keptPrice).hash() == ts2.hash());
+
+    TimeSeriesTransformations::Diff diff = ts1.diff(ts2);
+    assert(diff.inserted.empty() && diff.changed.empty());
+    assert(diff.removed.size() == time.size() - keptTime.size());
+    assert(ts2.diff(ts1).inserted == diff.removed);
+    assert(ts1.diff(ts1).empty());
+
+    // Changed, inserted and removed timestamps in one diff
+    TimeSeriesTransformations before({1, 2, 3, 5}, {10.0, 11.0, 12.0, 14.0});
+    TimeSeriesTransformations after({2, 3, 4, 5}, {11.0, 12.5, 13.0, 14.0});
+    diff = before.diff(after);
+    assert(diff.removed == std::vector<int>({1}));
+    assert(diff.inserted == std::vector<int>({4}));
+    assert(diff.changed == std::vector<int>({3}));
+
+    // -0.0 and 0.0 compare equal, so they hash equally
+    assert(TimeSeriesTransformations({1}, {0.0}).hash() == TimeSeriesTransformations({1}, {-0.0}).hash());
+    std::cout << "testHashAndDiff passed!" << std::endl;
+}
+
+// Test reindex() with each fill policy, and findGaps()
+void testReindexAndGaps() {
+    const int t = 1619125010;
+    TimeSeriesTransformations ts({t, t + 10, t + 30}, {1.0, 2.0, 4.0});
+    std::string start = TimeSeriesTransformations::unixToDateTime(t - 5);
+    std::vector<double> grid(10);
+
+    auto matches = [&grid](std::vector<double> expected) {
+        for (size_t i = 0; i < grid.size(); ++i) {
+            if (std::isnan(expected[i]) ? !std::isnan(grid[i]) : !almostEqual(grid[i], expected[i])) {
+                return false;
+            }
+        }
+        return true;
+    };
+    const double nan = std::nan("");
+
+    assert(ts.reindex(start, 5, TimeSeriesTransformations::FillPolicy::ForwardFill, &grid));
+    assert(matches({nan, 1, 1, 2, 2, 2, 2, 4, 4, 4}));
+    assert(ts.reindex(start, 5, TimeSeriesTransformations::FillPolicy::Linear, &grid));
+    assert(matches({nan, 1, 1.5, 2, 2.5, 3, 3.5, 4, nan, nan}));
+    assert(ts.reindex(start, 5, TimeSeriesTransformations::FillPolicy::NaN, &grid));
+    assert(matches({nan, 1, nan, 2, nan, nan, nan, 4, nan, nan}));
+    assert(!ts.reindex(start, 0, TimeSeriesTransformations::FillPolicy::Linear, &grid));
+    assert(std::isnan(grid[1]));
+
+    std::vector<TimeSeriesTransformations::Gap> gaps = ts.findGaps(15);
+    assert(gaps.size() == 1);
+    assert(gaps[0].from == t + 10 && gaps[0].to == t + 30 && gaps[0].duration == 20);
+    assert(ts.findGaps(20).empty());
+    std::cout << "testReindexAndGaps passed!" << std::endl;
+}
+
+// Test the streaming features, computed during ingestion, updated on append and rebuilt on other changes
+void testStreamingFeatures() {
+    std::vector<int> time = {1619125010, 1619130010, 1619135010, 1619140010};
+    std::vector<double> price = {100.0, 110.0, 99.0, 99.0};
+    TimeSeriesTransformations ts(time, price, "TestSeries");
+    const StreamingFeatures& history = ts.getFeatureHistory();
+
+    assert(history.count() == 4);
+    assert(history.logReturnHistory().size() == 3 && history.ewmaVolatilityHistory().size() == 3);
+    assert(almostEqual(history.logReturnHistory()[0], std::log(1.1)));
+    assert(almostEqual(history.percentReturnHistory()[1], -10.0));
+    assert(almostEqual(history.ewmaVolatilityHistory()[0], std::log(1.1)));
+    assert(almostEqual(history.ewmaMeanHistory()[1], 100.0 + 0.06 * 10.0));
+    const std::pmr::vector<double>& zScores = history.zScoreHistory();
+    assert(std::isnan(zScores[0]) && zScores[1] > 0 && zScores[2] < 0);
+
+    // Without the history only the latest features are kept
+    const StreamingFeatures& features = ts.getFeatures();
+    assert(features.count() == 4 && !features.keepsHistory() && features.ewmaMeanHistory().empty());
+    assert(features.ewmaMean() == history.ewmaMeanHistory().back());
+    assert(features.ewmaVolatility() == history.ewmaVolatilityHistory().back());
+    assert(features.logReturn() == 0.0 && features.zScore() == zScores.back());
+
+    // Appending updates the features in place, giving what a rebuild would
+    ts.addASharePrice(TimeSeriesTransformations::unixToDateTime(1619145010), 104.5);
+    std::vector<int> allTime = ts.getTime();
+    std::vector<double> allPrice = ts.getPrice();
+    TimeSeriesTransformations rebuilt(allTime, allPrice);
+    assert(ts.getFeatures().count() == 5 && ts.getFeatureHistory().count() == 5);
+    assert(ts.getFeatureHistory().ewmaMeanHistory() == rebuilt.getFeatureHistory().ewmaMeanHistory());
+    assert(ts.getFeatures().zScore() == rebuilt.getFeatures().zScore());
+
+    // Filters rebuild them
+    ts.removePricesLowerThan(100.0);
+    assert(ts.getFeatures().count() == 3 && ts.getFeatureHistory().logReturnHistory().size() == 2);
+
+    ts.setFeatureSmoothing(1.0);
+    assert(ts.getFeatures().getAlpha() == 1.0 && ts.getFeatureHistory().getAlpha() == 1.0);
+    assert(ts.getFeatures().ewmaMean() == ts.getPrice().back());
+
+    // Filtering a copy that shares the data keeps its smoothing
+    TimeSeriesTransformations copy(ts);
+    ts.setFeatureSmoothing(0.5);
+    TimeSeriesTransformations shared(ts);
+    assert(shared.removePricesGreaterThan(105.0) && !shared.sharesDataWith(ts));
+    assert(shared.featureSmoothing() == 0.5 && shared.getFeatureHistory().getAlpha() == 0.5);
+    assert(copy.removePricesGreaterThan(105.0) && copy.featureSmoothing() == 1.0);
+
+    TimeSeriesTransformations empty;
+    assert(empty.getFeatures().count() == 0 && std::isnan(empty.getFeatures().ewmaMean()));
+    std::cout << "testStreamingFeatures passed!" << std::endl;
+}
+
+// Test the bounded thread pool
+void testThreadPool() {
+    ThreadPool pool(3, 2);
+    std::atomic<int> sum(0);
+    for (int i = 1; i <= 100; ++i) {
+        pool.submit([&sum, i]() { sum += i; });
+    }
+    pool.wait();
+    assert(sum == 5050);
+    assert(pool.threadCount() == 3);
+
+    // Exceptions thrown by tasks come out of wait()
+    pool.submit([]() { throw std::runtime_error("task failed"); });
+    bool threw = false;
+    try {
+        pool.wait();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    std::cout << "testThreadPool passed!" << std::endl;
+}
+
 int main() {
     testConstructorFromCSV();
     testDefaultConstructor();
     testConstructorWithVectors();
+    testConstructorWithMemoryResource();
     testCopyConstructor();
     testAssignmentOperator();
+    testCopyOnWrite();
     testEqualityOperator();
+    testHashAndDiff();
     testGetName();
     testCount();
     testGetTime();
@@ -380,7 +1039,23 @@ int main() {
     testPrintIncrementsOnDate();
     testFindGreatestIncrements();
     testGetPriceAtDate();
+    testReindexAndGaps();
     testSaveData();
+    testSaveDataWithOptions();
+    testLoadAsync();
+    testLoadAsyncCancelled();
+    testSaveDataAsync();
+    testView();
+    testViewOnDate();
+    testBlockSummaryRangeStatistics();
+    testGreatestIncrementInRange();
+    testExecutionPolicies();
+    testQuantiles();
+    testTDigestMerge();
+    testHistogram();
+    testStreamingFeatures();
+    testDiskBackedTimeSeries();
+    testThreadPool();
 
     std::cout << "All tests passed!" << std::endl;
     return 0;
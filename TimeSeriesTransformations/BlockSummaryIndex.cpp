@@ -0,0 +1,201 @@
+#include "BlockSummaryIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Mean of the summarized values
+double SummaryStatistics::mean() const {
+    return sum / count;
+}
+
+// Sample standard deviation of the summarized values
+double SummaryStatistics::standardDeviation() const {
+    return std::sqrt(m2 / (count - 1));
+}
+
+// Combine two summaries using the pairwise update of Chan et al.
+SummaryStatistics SummaryStatistics::merge(const SummaryStatistics& a, const SummaryStatistics& b) {
+    if (a.count == 0) {
+        return b;
+    }
+    if (b.count == 0) {
+        return a;
+    }
+
+    SummaryStatistics result;
+    result.count = a.count + b.count;
+    result.sum = a.sum + b.sum;
+
+    double delta = b.mean() - a.mean();
+    result.m2 = a.m2 + b.m2 + delta * delta * (static_cast<double>(a.count) * b.count / result.count);
+    result.min = std::min(a.min, b.min);
+    result.max = std::max(a.max, b.max);
+    return result;
+}
+
+// Constructor
+BlockSummaryIndex::BlockSummaryIndex(std::pmr::memory_resource* resource) : blocks(resource) {}
+
+// Recompute the summaries affected by a change to the data at or after entry `from`
+void BlockSummaryIndex::update(const std::pair<int, double>* data, size_t size, size_t from) {
+    if (from > 0 && from == entries && size > entries) {
+        // Appended entries only change the tail, so fold each one into it
+        for (size_t i = from; i < size; ++i) {
+            append(data, i);
+        }
+        return;
+    }
+
+    // The increment ending at `from` belongs to the block of the entry before it
+    size_t firstBlock = (from == 0 ? 0 : from - 1) / blockSize;
+    size_t blockTotal = (size + blockSize - 1) / blockSize;
+    for (size_t b = std::min(firstBlock, blockTotal); b < blocks.size(); ++b) {
+        contentHash -= blocks[b].hash;
+    }
+    blocks.resize(std::min(firstBlock, blockTotal));
+
+    for (size_t b = blocks.size(); b < blockTotal; ++b) {
+        size_t begin = b * blockSize;
+        size_t end = std::min(size, begin + blockSize);
+
+        BlockSummary summary;
+        summary.prices = scan(data, begin, end, false);
+        summary.increments = scan(data, begin, std::min(end, size - 1), true);
+        summary.firstPrice = data[begin].second;
+        summary.lastPrice = data[end - 1].second;
+        for (size_t i = begin; i < end; ++i) {
+            summary.hash += entryHash(data[i]);
+        }
+        contentHash += summary.hash;
+        blocks.push_back(summary);
+    }
+    entries = size;
+}
+
+// Add entry i, appended after every summarized entry, in O(1)
+void BlockSummaryIndex::append(const std::pair<int, double>* data, size_t i) {
+    auto single = [](double value) {
+        SummaryStatistics summary;
+        summary.count = 1;
+        summary.sum = value;
+        summary.min = value;
+        summary.max = value;
+        return summary;
+    };
+
+    // The increment ending at entry i belongs to the block of the entry before it
+    BlockSummary& previous = blocks[(i - 1) / blockSize];
+    previous.increments = SummaryStatistics::merge(previous.increments, single(data[i].second - data[i - 1].second));
+
+    if (i % blockSize == 0) {
+        blocks.push_back(BlockSummary());
+        blocks.back().firstPrice = data[i].second;
+    }
+    BlockSummary& tail = blocks.back();
+    tail.prices = SummaryStatistics::merge(tail.prices, single(data[i].second));
+    tail.lastPrice = data[i].second;
+
+    uint64_t hash = entryHash(data[i]);
+    tail.hash += hash;
+    contentHash += hash;
+    entries = i + 1;
+}
+
+// Summarize the prices of entries [first, last)
+SummaryStatistics BlockSummaryIndex::prices(const std::pair<int, double>* data, size_t first, size_t last) const {
+    return summarize(data, first, last, false);
+}
+
+// Summarize the increments from entry i to i + 1 for i in [first, last)
+SummaryStatistics BlockSummaryIndex::increments(const std::pair<int, double>* data, size_t first, size_t last) const {
+    return summarize(data, first, last, true);
+}
+
+// Get the number of blocks
+size_t BlockSummaryIndex::blockCount() const {
+    return blocks.size();
+}
+
+// Get the summary of block b
+const BlockSummary& BlockSummaryIndex::block(size_t b) const {
+    return blocks[b];
+}
+
+// Get the content hash of the whole series
+uint64_t BlockSummaryIndex::hash() const {
+    return contentHash;
+}
+
+// Hash of one entry (splitmix64 finalizer); -0.0 hashes like 0.0, since the two compare equal
+uint64_t BlockSummaryIndex::entryHash(const std::pair<int, double>& entry) {
+    auto mix = [](uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    };
+
+    double price = entry.second == 0.0 ? 0.0 : entry.second;
+    uint64_t priceBits;
+    std::memcpy(&priceBits, &price, sizeof(priceBits));
+    return mix(priceBits + mix(static_cast<uint32_t>(entry.first) + 0x9e3779b97f4a7c15ULL));
+}
+
+// Summarize values [first, last) directly, two-pass for an accurate spread
+SummaryStatistics BlockSummaryIndex::scan(const std::pair<int, double>* data, size_t first, size_t last,
+    bool increments) {
+    SummaryStatistics result;
+    if (first >= last) {
+        return result;
+    }
+
+    auto value = [data, increments](size_t i) {
+        return increments ? data[i + 1].second - data[i].second : data[i].second;
+    };
+
+    result.count = last - first;
+    for (size_t i = first; i < last; ++i) {
+        double v = value(i);
+        result.sum += v;
+        result.min = std::min(result.min, v);
+        result.max = std::max(result.max, v);
+    }
+
+    double mean = result.mean();
+    for (size_t i = first; i < last; ++i) {
+        result.m2 += (value(i) - mean) * (value(i) - mean);
+    }
+    return result;
+}
+
+// Combine the whole blocks in [first, last) and scan the partial blocks at either end
+SummaryStatistics BlockSummaryIndex::summarize(const std::pair<int, double>* data, size_t first, size_t last,
+    bool increments) const {
+    if (first >= last) {
+        return SummaryStatistics();
+    }
+
+    auto whole = [this, increments](size_t b) {
+        return increments ? blocks[b].increments : blocks[b].prices;
+    };
+
+    size_t firstBlock = first / blockSize;
+    size_t lastBlock = (last - 1) / blockSize;
+    size_t firstBlockEnd = (firstBlock + 1) * blockSize;
+
+    if (firstBlock == lastBlock) {
+        bool wholeBlock = first == firstBlock * blockSize && last == firstBlock * blockSize + whole(firstBlock).count;
+        return wholeBlock ? whole(firstBlock) : scan(data, first, last, increments);
+    }
+
+    SummaryStatistics result = first == firstBlock * blockSize
+        ? whole(firstBlock) : scan(data, first, firstBlockEnd, increments);
+
+    for (size_t b = firstBlock + 1; b < lastBlock; ++b) {
+        result = SummaryStatistics::merge(result, whole(b));
+    }
+
+    size_t lastBlockBegin = lastBlock * blockSize;
+    SummaryStatistics tail = last == lastBlockBegin + whole(lastBlock).count
+        ? whole(lastBlock) : scan(data, lastBlockBegin, last, increments);
+    return SummaryStatistics::merge(result, tail);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+
+// Count, sum, spread and extremes of a set of values, mergeable with other summaries
+struct SummaryStatistics {
+    size_t count = 0;
+    double sum = 0.0;
+    double m2 = 0.0; // Sum of squared deviations from the mean
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    double mean() const;
+    double standardDeviation() const;
+
+    // Combine the summaries of two disjoint sets of values
+    static SummaryStatistics merge(const SummaryStatistics& a, const SummaryStatistics& b);
+};
+
+// Summary of one block of consecutive entries
+struct BlockSummary {
+    SummaryStatistics prices; // Prices of the entries in the block
+    SummaryStatistics increments; // Increments from each entry in the block to the next entry
+    double firstPrice = 0.0;
+    double lastPrice = 0.0;
+    uint64_t hash = 0; // Sum of the entry hashes of the block
+};
+
+// Per-block summaries of a sorted series, so aggregates over a range of entries combine the
+// whole blocks inside it and only scan the partial blocks at its edges: O(n / B + B)
+class BlockSummaryIndex {
+public:
+    static constexpr size_t blockSize = 4096; // Entries per block (B)
+
+    // Constructor; the summaries are allocated from the given memory resource
+    explicit BlockSummaryIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Recompute the summaries affected by a change to the data at or after entry `from`
+    void update(const std::pair<int, double>* data, size_t size, size_t from);
+
+    // Summarize the prices of entries [first, last)
+    SummaryStatistics prices(const std::pair<int, double>* data, size_t first, size_t last) const;
+    // Summarize the increments from entry i to i + 1 for i in [first, last)
+    SummaryStatistics increments(const std::pair<int, double>* data, size_t first, size_t last) const;
+
+    size_t blockCount() const;
+    const BlockSummary& block(size_t b) const;
+
+    // Content hash of the whole series: the sum of the entry hashes, so the hash of a sorted series
+    // depends only on its entries, and hashes of disjoint ranges (e.g. blocks) add up
+    uint64_t hash() const;
+    static uint64_t entryHash(const std::pair<int, double>& entry);
+
+private:
+    std::pmr::vector<BlockSummary> blocks;
+    size_t entries = 0; // Number of entries summarized
+    uint64_t contentHash = 0;
+
+    void append(const std::pair<int, double>* data, size_t i);
+
+    static SummaryStatistics scan(const std::pair<int, double>* data, size_t first, size_t last, bool increments);
+    SummaryStatistics summarize(const std::pair<int, double>* data, size_t first, size_t last, bool increments) const;
+};
@@ -0,0 +1,571 @@
+#include "DiskBackedTimeSeries.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <cmath>
+#include <filesystem>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char* const manifestName = "manifest.csv";
+
+    // Byte offset of the price column in a segment file: the time column padded to 8 bytes
+    size_t priceOffset(size_t count) {
+        return (count * sizeof(int) + 7) / 8 * 8;
+    }
+
+    // Reads the (time, price) entries of a sorted run file in order
+    struct RunReader {
+        std::ifstream in;
+        std::pair<int, double> current;
+
+        bool next() {
+            in.read(reinterpret_cast<char*>(&current.first), sizeof(current.first));
+            in.read(reinterpret_cast<char*>(&current.second), sizeof(current.second));
+            return static_cast<bool>(in);
+        }
+    };
+}
+
+// A segment file mapped into memory; the mapping is released when the last user lets go of it
+class DiskBackedTimeSeries::MappedSegment {
+public:
+    MappedSegment(const std::string& path, size_t count) : count(count) {
+        length = priceOffset(count) + count * sizeof(double);
+#ifdef _WIN32
+        // Read the segment into memory on Windows
+        storage.resize(length);
+        std::ifstream in(path, std::ios::binary);
+        if (!in.read(storage.data(), static_cast<std::streamsize>(length))) {
+            throw std::runtime_error("Unable to read segment " + path);
+        }
+        const char* base = storage.data();
+#else
+        // Map the segment read-only on Unix-like systems
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Unable to open segment " + path);
+        }
+        address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED) {
+            throw std::runtime_error("Unable to map segment " + path);
+        }
+        madvise(address, length, MADV_SEQUENTIAL);
+        const char* base = static_cast<const char*>(address);
+#endif
+        times = reinterpret_cast<const int*>(base);
+        prices = reinterpret_cast<const double*>(base + priceOffset(count));
+    }
+
+    ~MappedSegment() {
+#ifndef _WIN32
+        munmap(address, length);
+#endif
+    }
+
+    MappedSegment(const MappedSegment&) = delete;
+    MappedSegment& operator=(const MappedSegment&) = delete;
+
+    const int* times;
+    const double* prices;
+    size_t count;
+
+private:
+    size_t length;
+#ifdef _WIN32
+    std::vector<char> storage;
+#else
+    void* address;
+#endif
+};
+
+// Build a store in `directory` from a CSV file: sorted runs of rowsPerSegment entries are written to
+// temporary files, then merged into segments
+DiskBackedTimeSeries DiskBackedTimeSeries::create(const std::string& csvPath, const std::string& directory,
+    size_t rowsPerSegment, size_t cachedSegments) {
+    namespace fs = std::filesystem;
+
+    if (rowsPerSegment == 0) {
+        throw std::invalid_argument("Segments must hold at least one entry.");
+    }
+
+    std::ifstream csv(csvPath);
+    if (!csv.is_open()) {
+        throw std::runtime_error("Unable to open file " + csvPath);
+    }
+
+    fs::create_directories(directory);
+    if (fs::exists(fs::path(directory) / manifestName)) {
+        throw std::runtime_error("A series is already stored in " + directory);
+    }
+
+    // Parse with the in-memory loader, one run at a time
+    TimeSeriesTransformations run;
+    std::string header;
+    std::getline(csv, header);
+    run.readCsvHeader(header);
+
+    std::vector<std::string> runFiles;
+    auto writeRun = [&]() {
+        std::sort(run.storage->P3data.begin(), run.storage->P3data.end());
+        runFiles.push_back((fs::path(directory) / ("run-" + std::to_string(runFiles.size()) + ".tmp")).string());
+
+        std::ofstream out(runFiles.back(), std::ios::binary);
+        for (const auto& entry : run.storage->P3data) {
+            out.write(reinterpret_cast<const char*>(&entry.first), sizeof(entry.first));
+            out.write(reinterpret_cast<const char*>(&entry.second), sizeof(entry.second));
+        }
+        if (!out) {
+            throw std::runtime_error("Unable to write " + runFiles.back());
+        }
+        run.storage->P3data.clear();
+    };
+
+    std::string line;
+    while (std::getline(csv, line)) {
+        run.appendCsvLine(line, csvPath);
+        if (run.storage->P3data.size() == rowsPerSegment) {
+            writeRun();
+        }
+    }
+    if (!run.storage->P3data.empty()) {
+        writeRun();
+    }
+
+    // Merge the runs, smallest entry first, cutting a segment every rowsPerSegment entries
+    std::vector<RunReader> readers(runFiles.size());
+    using Head = std::pair<std::pair<int, double>, size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    for (size_t r = 0; r < runFiles.size(); ++r) {
+        readers[r].in.open(runFiles[r], std::ios::binary);
+        if (readers[r].next()) {
+            heads.push({ readers[r].current, r });
+        }
+    }
+
+    std::vector<SegmentInfo> segments;
+    std::vector<int> times;
+    std::vector<double> prices;
+    times.reserve(rowsPerSegment);
+    prices.reserve(rowsPerSegment);
+
+    while (!heads.empty()) {
+        Head head = heads.top();
+        heads.pop();
+        times.push_back(head.first.first);
+        prices.push_back(head.first.second);
+
+        if (readers[head.second].next()) {
+            heads.push({ readers[head.second].current, head.second });
+        }
+        if (times.size() == rowsPerSegment || heads.empty()) {
+            segments.push_back(writeSegment(directory, segments.size(), times.data(), prices.data(), times.size()));
+            times.clear();
+            prices.clear();
+        }
+    }
+
+    readers.clear();
+    for (const auto& file : runFiles) {
+        fs::remove(file);
+    }
+
+    writeManifest(directory, run.getName(), segments.size(), segments);
+    return DiskBackedTimeSeries(directory, cachedSegments);
+}
+
+// Open an existing store
+DiskBackedTimeSeries::DiskBackedTimeSeries(const std::string& directory, size_t cachedSegments)
+    : directory(directory), cacheCapacity(std::max<size_t>(1, cachedSegments)) {
+    std::string path = (std::filesystem::path(directory) / manifestName).string();
+    std::ifstream manifest(path);
+    if (!manifest.is_open()) {
+        throw std::runtime_error("Unable to open file " + path);
+    }
+
+    std::string line;
+    std::getline(manifest, line); // "name,<name>"
+    _name = line.substr(std::min(line.size(), line.find(',') + 1));
+    std::getline(manifest, line); // "nextSegment,<number>"
+
+    try {
+        nextSegment = std::stoul(line.substr(line.find(',') + 1));
+
+        // "<file>,<count>,<firstTime>,<lastTime>,<minPrice>,<maxPrice>"
+        while (std::getline(manifest, line)) {
+            std::stringstream fields(line);
+            std::string file, countStr, firstStr, lastStr, minStr, maxStr;
+            if (std::getline(fields, file, ',') && std::getline(fields, countStr, ',') &&
+                std::getline(fields, firstStr, ',') && std::getline(fields, lastStr, ',') &&
+                std::getline(fields, minStr, ',') && std::getline(fields, maxStr)) {
+                segments.push_back({ file, std::stoul(countStr), std::stoi(firstStr), std::stoi(lastStr),
+                    std::stod(minStr), std::stod(maxStr) });
+            }
+        }
+    } catch (const std::exception&) {
+        throw std::runtime_error("Invalid data format in file: " + path);
+    }
+}
+
+DiskBackedTimeSeries::~DiskBackedTimeSeries() {}
+
+// Calculate the mean of the prices, streaming over the segments
+bool DiskBackedTimeSeries::mean(double* meanValue) const {
+    try {
+        if (count() == 0) {
+            throw std::runtime_error("Empty vector!!");
+        }
+
+        // Add the prices in the same order as the in-memory series, so the results agree exactly
+        double sum = 0.0;
+        forEachEntry(0, [&sum](int, double price) {
+            sum += price;
+            return true;
+        });
+
+        *meanValue = sum / count();
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        *meanValue = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+}
+
+// Calculate the standard deviation of the prices with two streaming passes
+bool DiskBackedTimeSeries::standardDeviation(double* standardDeviationValue) const {
+    double meanValue;
+    if (!mean(&meanValue)) {
+        *standardDeviationValue = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+
+    try {
+        double sumSquares = 0.0;
+        forEachEntry(0, [&sumSquares, meanValue](int, double price) {
+            sumSquares += (price - meanValue) * (price - meanValue);
+            return true;
+        });
+
+        *standardDeviationValue = std::sqrt(sumSquares / (count() - 1));
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        *standardDeviationValue = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+}
+
+// Remove the entry at a specific time, rewriting only the segment whose time range contains it
+bool DiskBackedTimeSeries::removeEntryAtTime(std::string time) {
+    int unix = static_cast<int>(TimeSeriesTransformations::dateTimeToUnix(time));
+
+    return removeIf(
+        [unix](const SegmentInfo& info) { return info.firstTime <= unix && info.lastTime >= unix ? 1 : 0; },
+        [unix](int t, double) { return t == unix; });
+}
+
+// Remove prices greater than a specified value
+bool DiskBackedTimeSeries::removePricesGreaterThan(double price) {
+    return removeIf(
+        [price](const SegmentInfo& info) { return info.maxPrice <= price ? 0 : info.minPrice > price ? 2 : 1; },
+        [price](int, double p) { return p > price; });
+}
+
+// Remove prices lower than a specified value
+bool DiskBackedTimeSeries::removePricesLowerThan(double price) {
+    return removeIf(
+        [price](const SegmentInfo& info) { return info.minPrice >= price ? 0 : info.maxPrice < price ? 2 : 1; },
+        [price](int, double p) { return p < price; });
+}
+
+// Remove prices before a specified date
+bool DiskBackedTimeSeries::removePricesBefore(std::string date) {
+    int unix = static_cast<int>(TimeSeriesTransformations::dateTimeToUnix(date));
+
+    return removeIf(
+        [unix](const SegmentInfo& info) { return info.firstTime >= unix ? 0 : info.lastTime < unix ? 2 : 1; },
+        [unix](int t, double) { return t < unix; });
+}
+
+// Remove prices after a specified date
+bool DiskBackedTimeSeries::removePricesAfter(std::string date) {
+    int unix = static_cast<int>(TimeSeriesTransformations::dateTimeToUnix(date));
+
+    return removeIf(
+        [unix](const SegmentInfo& info) { return info.lastTime <= unix ? 0 : info.firstTime > unix ? 2 : 1; },
+        [unix](int t, double) { return t > unix; });
+}
+
+// Print share prices on a specific date, reading only the segments that overlap it
+std::string DiskBackedTimeSeries::printSharePricesOnDate(std::string date) const {
+    int dayStart = TimeSeriesTransformations::truncData(date);
+    int dayEnd = dayStart + 86400;
+    std::string sharePrices;
+
+    forEachEntry(firstSegmentEndingAtOrAfter(dayStart), [&](int time, double price) {
+        if (time >= dayStart && time < dayEnd) {
+            sharePrices += std::to_string(price) + '\n';
+        }
+        return time < dayEnd;
+    });
+
+    std::cout << "SharePrices on the " + date + " are:" << std::endl << sharePrices << std::endl;
+    return sharePrices;
+}
+
+// Print increments on a specific date; the last one may run into the following segment
+std::string DiskBackedTimeSeries::printIncrementsOnDate(std::string date) const {
+    int dayStart = TimeSeriesTransformations::truncData(date);
+    int dayEnd = dayStart + 86400;
+    std::string increments;
+    bool havePrevious = false;
+    int previousTime = 0;
+    double previousPrice = 0.0;
+
+    forEachEntry(firstSegmentEndingAtOrAfter(dayStart), [&](int time, double price) {
+        if (havePrevious && previousTime >= dayStart && previousTime < dayEnd) {
+            increments += std::to_string(price - previousPrice) + '\n';
+        }
+        havePrevious = true;
+        previousTime = time;
+        previousPrice = price;
+        return time < dayEnd;
+    });
+
+    std::cout << "Increments on the " + date + " are:" << std::endl << increments << std::endl;
+    return increments;
+}
+
+// Get the price at a specific date by binary search over the manifest, then within one segment
+bool DiskBackedTimeSeries::getPriceAtDate(const std::string date, double* value) const {
+    int unix = static_cast<int>(TimeSeriesTransformations::dateTimeToUnix(date));
+    size_t s = firstSegmentEndingAtOrAfter(unix);
+
+    if (s < segments.size() && segments[s].firstTime <= unix) {
+        auto mapped = segment(s);
+        const int* it = std::lower_bound(mapped->times, mapped->times + mapped->count, unix);
+        if (it != mapped->times + mapped->count && *it == unix) {
+            *value = mapped->prices[it - mapped->times];
+            return true;
+        }
+    }
+
+    *value = std::numeric_limits<double>::quiet_NaN();
+    return false;
+}
+
+// Load the entries between two dates (inclusive) into memory
+TimeSeriesTransformations DiskBackedTimeSeries::toSeries(std::string from, std::string to) const {
+    int fromUnix = static_cast<int>(TimeSeriesTransformations::dateTimeToUnix(from));
+    int toUnix = static_cast<int>(TimeSeriesTransformations::dateTimeToUnix(to));
+    std::vector<int> time;
+    std::vector<double> price;
+
+    forEachEntry(firstSegmentEndingAtOrAfter(fromUnix), [&](int t, double p) {
+        if (t >= fromUnix && t <= toUnix) {
+            time.push_back(t);
+            price.push_back(p);
+        }
+        return t <= toUnix;
+    });
+
+    return TimeSeriesTransformations(time, price, _name);
+}
+
+// Get the number of observations
+int DiskBackedTimeSeries::count() const {
+    size_t total = 0;
+    for (const auto& info : segments) {
+        total += info.count;
+    }
+    return static_cast<int>(total);
+}
+
+// Get the name of the time series
+std::string DiskBackedTimeSeries::getName() const {
+    return _name;
+}
+
+// Get the number of segments
+size_t DiskBackedTimeSeries::segmentCount() const {
+    return segments.size();
+}
+
+// Map segment s, or take it from the cache, evicting the least recently used segment when full
+std::shared_ptr<const DiskBackedTimeSeries::MappedSegment> DiskBackedTimeSeries::segment(size_t s) const {
+    const SegmentInfo& info = segments[s];
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    auto cached = cache.find(info.file);
+    if (cached != cache.end()) {
+        lru.splice(lru.begin(), lru, cached->second.second);
+        return cached->second.first;
+    }
+
+    std::string path = (std::filesystem::path(directory) / info.file).string();
+    auto mapped = std::make_shared<const MappedSegment>(path, info.count);
+
+    if (cache.size() >= cacheCapacity) {
+        cache.erase(lru.back());
+        lru.pop_back();
+    }
+    lru.push_front(info.file);
+    cache[info.file] = { mapped, lru.begin() };
+    return mapped;
+}
+
+// Drop a segment from the cache
+void DiskBackedTimeSeries::evict(const std::string& file) const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    auto cached = cache.find(file);
+    if (cached != cache.end()) {
+        lru.erase(cached->second.second);
+        cache.erase(cached);
+    }
+}
+
+// Index of the first segment whose last entry is at or after a time
+size_t DiskBackedTimeSeries::firstSegmentEndingAtOrAfter(int time) const {
+    auto it = std::lower_bound(segments.begin(), segments.end(), time,
+        [](const SegmentInfo& info, int t) {
+            return info.lastTime < t;
+        });
+    return static_cast<size_t>(it - segments.begin());
+}
+
+// Call fn(time, price) for the entries from the start of a segment onwards, until it returns false
+template <typename Fn>
+void DiskBackedTimeSeries::forEachEntry(size_t firstSegment, Fn fn) const {
+    for (size_t s = firstSegment; s < segments.size(); ++s) {
+        auto mapped = segment(s);
+        for (size_t i = 0; i < mapped->count; ++i) {
+            if (!fn(mapped->times[i], mapped->prices[i])) {
+                return;
+            }
+        }
+    }
+}
+
+// Remove the entries matching `remove`. classify(segment) says whether a segment can have none (0),
+// some (1) or only (2) matching entries, so only segments with some matches are read and rewritten
+template <typename Classify, typename Remove>
+bool DiskBackedTimeSeries::removeIf(Classify classify, Remove remove) {
+    std::vector<SegmentInfo> kept;
+    std::vector<std::string> obsolete;
+    bool removed = false;
+
+    for (size_t s = 0; s < segments.size(); ++s) {
+        int kind = classify(segments[s]);
+        if (kind == 0) {
+            kept.push_back(segments[s]);
+            continue;
+        }
+
+        obsolete.push_back(segments[s].file);
+        if (kind == 2) {
+            removed = true;
+            continue;
+        }
+
+        std::vector<int> times;
+        std::vector<double> prices;
+        {
+            auto mapped = segment(s);
+            for (size_t i = 0; i < mapped->count; ++i) {
+                if (!remove(mapped->times[i], mapped->prices[i])) {
+                    times.push_back(mapped->times[i]);
+                    prices.push_back(mapped->prices[i]);
+                }
+            }
+        }
+
+        if (times.size() == segments[s].count) {
+            obsolete.pop_back();
+            kept.push_back(segments[s]);
+            continue;
+        }
+
+        removed = true;
+        if (!times.empty()) {
+            kept.push_back(writeSegment(directory, nextSegment++, times.data(), prices.data(), times.size()));
+        }
+    }
+
+    if (!removed) {
+        return false;
+    }
+
+    // Switch to the new manifest before deleting the files it no longer lists
+    segments = kept;
+    saveManifest();
+    for (const auto& file : obsolete) {
+        evict(file);
+        std::filesystem::remove(std::filesystem::path(directory) / file);
+    }
+    return true;
+}
+
+// Write the manifest of this store
+void DiskBackedTimeSeries::saveManifest() const {
+    writeManifest(directory, _name, nextSegment, segments);
+}
+
+// Write a segment file: the time column, padding to 8 bytes, then the price column
+DiskBackedTimeSeries::SegmentInfo DiskBackedTimeSeries::writeSegment(const std::string& directory, size_t number,
+    const int* times, const double* prices, size_t count) {
+    SegmentInfo info;
+    info.file = "segment-" + std::to_string(number) + ".bin";
+    info.count = count;
+    info.firstTime = times[0];
+    info.lastTime = times[count - 1];
+    info.minPrice = *std::min_element(prices, prices + count);
+    info.maxPrice = *std::max_element(prices, prices + count);
+
+    std::string path = (std::filesystem::path(directory) / info.file).string();
+    std::ofstream out(path, std::ios::binary);
+    const char padding[8] = {};
+    out.write(reinterpret_cast<const char*>(times), static_cast<std::streamsize>(count * sizeof(int)));
+    out.write(padding, static_cast<std::streamsize>(priceOffset(count) - count * sizeof(int)));
+    out.write(reinterpret_cast<const char*>(prices), static_cast<std::streamsize>(count * sizeof(double)));
+
+    if (!out) {
+        throw std::runtime_error("Unable to save data to file: " + path);
+    }
+    return info;
+}
+
+// Write a manifest, replacing the old one only once the new one is complete
+void DiskBackedTimeSeries::writeManifest(const std::string& directory, const std::string& name, size_t nextSegment,
+    const std::vector<SegmentInfo>& segments) {
+    std::filesystem::path path = std::filesystem::path(directory) / manifestName;
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+
+    {
+        std::ofstream manifest(temporary);
+        manifest << "name," << name << '\n';
+        manifest << "nextSegment," << nextSegment << '\n';
+        for (const auto& info : segments) {
+            manifest << info.file << ',' << info.count << ',' << info.firstTime << ',' << info.lastTime << ','
+                     << TimeSeriesTransformations::formatDouble(info.minPrice) << ','
+                     << TimeSeriesTransformations::formatDouble(info.maxPrice) << '\n';
+        }
+        if (!manifest) {
+            throw std::runtime_error("Unable to save data to file: " + temporary.string());
+        }
+    }
+
+    std::filesystem::rename(temporary, path);
+}
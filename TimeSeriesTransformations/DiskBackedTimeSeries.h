@@ -0,0 +1,95 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include "TimeSeriesTransformations.h"
+
+// Out-of-core time series for histories larger than memory. The series is kept in a directory as
+// sorted, fixed-size segments, each holding a time column and a price column, plus a manifest with
+// every segment's time and price range. Segments are memory-mapped on demand and at most
+// `cachedSegments` stay mapped (least recently used first out), so memory use is bounded by
+// cachedSegments * rowsPerSegment entries whatever the size of the series.
+class DiskBackedTimeSeries {
+public:
+    static constexpr size_t defaultRowsPerSegment = 1 << 20;
+    static constexpr size_t defaultCachedSegments = 8;
+
+    // Build a store in `directory` from a CSV file, sorting it with an external merge sort
+    static DiskBackedTimeSeries create(const std::string& csvPath, const std::string& directory,
+        size_t rowsPerSegment = defaultRowsPerSegment, size_t cachedSegments = defaultCachedSegments);
+
+    // Open an existing store
+    explicit DiskBackedTimeSeries(const std::string& directory, size_t cachedSegments = defaultCachedSegments);
+    ~DiskBackedTimeSeries();
+
+    DiskBackedTimeSeries(const DiskBackedTimeSeries&) = delete;
+    DiskBackedTimeSeries& operator=(const DiskBackedTimeSeries&) = delete;
+
+    // Statistical functions
+    bool mean(double* meanValue) const;
+    bool standardDeviation(double* standardDeviationValue) const;
+
+    // Data manipulation functions; segments that cannot contain a removed entry are not read
+    bool removeEntryAtTime(std::string time);
+    bool removePricesGreaterThan(double price);
+    bool removePricesLowerThan(double price);
+    bool removePricesBefore(std::string date);
+    bool removePricesAfter(std::string date);
+
+    // Print functions
+    std::string printSharePricesOnDate(std::string date) const;
+    std::string printIncrementsOnDate(std::string date) const;
+
+    // Utility functions
+    bool getPriceAtDate(const std::string date, double* value) const;
+
+    // Load the entries between two dates (inclusive) into memory
+    TimeSeriesTransformations toSeries(std::string from, std::string to) const;
+
+    // Getters
+    int count() const;
+    std::string getName() const;
+    size_t segmentCount() const;
+
+private:
+    class MappedSegment;
+
+    struct SegmentInfo {
+        std::string file; // File name within the store directory
+        size_t count; // Number of entries
+        int firstTime;
+        int lastTime;
+        double minPrice;
+        double maxPrice;
+    };
+
+    std::string directory;
+    std::string _name;
+    std::vector<SegmentInfo> segments; // In time order
+    size_t nextSegment = 0; // Number used to name the next segment file
+    size_t cacheCapacity;
+
+    // Mapped segments by file name, most recently used at the front of `lru`
+    mutable std::mutex cacheMutex;
+    mutable std::list<std::string> lru;
+    mutable std::unordered_map<std::string,
+        std::pair<std::shared_ptr<const MappedSegment>, std::list<std::string>::iterator>> cache;
+
+    std::shared_ptr<const MappedSegment> segment(size_t s) const;
+    void evict(const std::string& file) const;
+    size_t firstSegmentEndingAtOrAfter(int time) const;
+    template <typename Fn>
+    void forEachEntry(size_t firstSegment, Fn fn) const;
+    template <typename Classify, typename Remove>
+    bool removeIf(Classify classify, Remove remove);
+    void saveManifest() const;
+
+    static SegmentInfo writeSegment(const std::string& directory, size_t number,
+        const int* times, const double* prices, size_t count);
+    static void writeManifest(const std::string& directory, const std::string& name, size_t nextSegment,
+        const std::vector<SegmentInfo>& segments);
+};
@@ -0,0 +1,95 @@
+#include "Histogram.h"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// Constructor for `bins` equal-width bins over [lower, upper)
+Histogram::Histogram(double lower, double upper, size_t bins)
+    : lower(lower), upper(upper), width((upper - lower) / bins), counts(bins, 0) {
+    if (bins == 0 || !(lower < upper)) {
+        throw std::invalid_argument("Histogram needs at least one bin and lower < upper.");
+    }
+}
+
+// Add one value
+void Histogram::add(double value) {
+    if (std::isnan(value)) {
+        return;
+    }
+
+    ++total;
+    if (value < lower) {
+        ++below;
+    } else if (value >= upper) {
+        ++above;
+    } else {
+        size_t bin = static_cast<size_t>((value - lower) / width);
+        ++counts[bin < counts.size() ? bin : counts.size() - 1];
+    }
+}
+
+// Merge another histogram with the same bins into this one
+void Histogram::merge(const Histogram& other) {
+    if (other.lower != lower || other.upper != upper || other.counts.size() != counts.size()) {
+        throw std::invalid_argument("Cannot merge histograms with different bins.");
+    }
+
+    for (size_t bin = 0; bin < counts.size(); ++bin) {
+        counts[bin] += other.counts[bin];
+    }
+    below += other.below;
+    above += other.above;
+    total += other.total;
+}
+
+// Estimated q-th quantile, interpolating within the bin that contains it
+double Histogram::quantile(double q) const {
+    if (total == 0 || q < 0.0 || q > 1.0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    double rank = q * total;
+    double before = static_cast<double>(below);
+    if (rank < before) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    for (size_t bin = 0; bin < counts.size(); ++bin) {
+        if (counts[bin] > 0 && rank <= before + counts[bin]) {
+            return binLower(bin) + (rank - before) / counts[bin] * width;
+        }
+        before += counts[bin];
+    }
+
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+// Get the number of values added
+size_t Histogram::count() const {
+    return total;
+}
+
+// Get the number of bins
+size_t Histogram::binCount() const {
+    return counts.size();
+}
+
+// Get the number of values in a bin
+size_t Histogram::countInBin(size_t bin) const {
+    return counts[bin];
+}
+
+// Get the lower edge of a bin
+double Histogram::binLower(size_t bin) const {
+    return lower + bin * width;
+}
+
+// Get the number of values below the binned range
+size_t Histogram::underflow() const {
+    return below;
+}
+
+// Get the number of values at or above the top of the binned range
+size_t Histogram::overflow() const {
+    return above;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Fixed-width bins over [lower, upper) with counts of values falling below and above the range.
+// Histograms with the same bins can be merged.
+class Histogram {
+public:
+    Histogram(double lower, double upper, size_t bins);
+
+    void add(double value);
+    void merge(const Histogram& other);
+
+    // Estimated q-th quantile, interpolating within the bin that contains it; NaN if empty or
+    // if the quantile falls outside the binned range
+    double quantile(double q) const;
+
+    size_t count() const;
+    size_t binCount() const;
+    size_t countInBin(size_t bin) const;
+    double binLower(size_t bin) const;
+    size_t underflow() const;
+    size_t overflow() const;
+
+private:
+    double lower;
+    double upper;
+    double width; // Width of each bin
+    std::vector<size_t> counts;
+    size_t below = 0; // Values less than lower
+    size_t above = 0; // Values greater than or equal to upper
+    size_t total = 0;
+};
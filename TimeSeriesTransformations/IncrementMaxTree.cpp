@@ -0,0 +1,87 @@
+#include "IncrementMaxTree.h"
+#include <algorithm>
+
+// Constructor
+IncrementMaxTree::IncrementMaxTree(std::pmr::memory_resource* resource) : values(resource), tree(resource) {}
+
+// Recompute the increments affected by a change to the data at or after entry `from`
+void IncrementMaxTree::update(const std::pair<int, double>* data, size_t size, size_t from) {
+    size_t newCount = size < 2 ? 0 : size - 1;
+    // The increment ending at `from` changes too
+    size_t start = std::min(from == 0 ? 0 : from - 1, newCount);
+    size_t oldCount = count;
+    count = newCount;
+
+    // Grow by doubling, shrink once three quarters empty; either way every leaf is rewritten
+    size_t newLeaves = leaves;
+    if (newLeaves < count || (newLeaves > 1 && count < newLeaves / 4)) {
+        newLeaves = 1;
+        while (newLeaves < count) {
+            newLeaves *= 2;
+        }
+    }
+    if (newLeaves != leaves) {
+        start = 0;
+        oldCount = 0;
+        rebuild(newLeaves);
+    }
+
+    size_t end = std::max(oldCount, count);
+    if (start >= end) {
+        return;
+    }
+
+    for (size_t i = start; i < end; ++i) {
+        values[i] = i < count ? data[i + 1].second - data[i].second : 0.0;
+        tree[leaves + i] = i < count ? i : npos;
+    }
+
+    // Recompute the parents of the rewritten leaves, one level at a time
+    for (size_t lo = (leaves + start) / 2, hi = (leaves + end - 1) / 2; lo >= 1; lo /= 2, hi /= 2) {
+        for (size_t node = lo; node <= hi; ++node) {
+            tree[node] = better(tree[2 * node], tree[2 * node + 1]);
+        }
+    }
+}
+
+// Index of the greatest increment i in [first, last), the first one on ties; npos if the range is empty
+size_t IncrementMaxTree::maxIncrement(size_t first, size_t last) const {
+    last = std::min(last, count);
+    size_t leftBest = npos;
+    size_t rightBest = npos;
+
+    // Walk up from both ends, collecting nodes left to right on the left and right to left on the right
+    for (size_t l = first + leaves, r = last + leaves; l < r; l /= 2, r /= 2) {
+        if (l & 1) {
+            leftBest = better(leftBest, tree[l++]);
+        }
+        if (r & 1) {
+            rightBest = better(tree[--r], rightBest);
+        }
+    }
+
+    return better(leftBest, rightBest);
+}
+
+// Increment i
+double IncrementMaxTree::increment(size_t i) const {
+    return values[i];
+}
+
+// The index with the greater increment, preferring `left` on ties; npos stands for no increment
+size_t IncrementMaxTree::better(size_t left, size_t right) const {
+    if (right == npos) {
+        return left;
+    }
+    if (left == npos) {
+        return right;
+    }
+    return values[right] > values[left] ? right : left;
+}
+
+// Resize to the given number of leaves with every leaf empty
+void IncrementMaxTree::rebuild(size_t newLeaves) {
+    leaves = newLeaves;
+    values.assign(leaves, 0.0);
+    tree.assign(2 * leaves, npos);
+}
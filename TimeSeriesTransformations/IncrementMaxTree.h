@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <memory_resource>
+
+// Segment tree over the increments of a sorted series (increment i runs from entry i to i + 1),
+// answering "greatest increment in a range" in O(log n). Appending an entry updates it in O(log n).
+class IncrementMaxTree {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // Constructor; the tree is allocated from the given memory resource
+    explicit IncrementMaxTree(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Recompute the increments affected by a change to the data at or after entry `from`
+    void update(const std::pair<int, double>* data, size_t size, size_t from);
+
+    // Index of the greatest increment i in [first, last), the first one on ties; npos if the range is empty
+    size_t maxIncrement(size_t first, size_t last) const;
+
+    // Increment i
+    double increment(size_t i) const;
+
+private:
+    size_t leaves = 0; // Number of leaves, a power of two
+    size_t count = 0; // Number of increments stored
+    std::pmr::vector<double> values; // Increment at each leaf
+    std::pmr::vector<size_t> tree; // Index of the greatest increment under each node; tree[leaves + i] is leaf i
+
+    size_t better(size_t left, size_t right) const;
+    void rebuild(size_t newLeaves);
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Helpers for splitting a range of items into contiguous chunks processed on worker threads
+namespace ParallelChunks {
+
+    // Number of workers to use for n items, keeping at least minChunk items per worker
+    inline size_t workerCount(size_t n, size_t minChunk) {
+        size_t hardware = std::max<size_t>(1, std::thread::hardware_concurrency());
+        size_t byWork = std::max<size_t>(1, n / std::max<size_t>(1, minChunk));
+        return std::min(hardware, byWork);
+    }
+
+    // Start index of chunk c when n items are split into `workers` chunks
+    inline size_t chunkBegin(size_t n, size_t workers, size_t c) {
+        return n / workers * c + std::min(c, n % workers);
+    }
+
+    // Call fn(chunk, begin, end) for every chunk; chunk 0 runs on the calling thread
+    template <typename Fn>
+    void run(size_t n, size_t workers, Fn fn) {
+        if (workers <= 1) {
+            fn(size_t{ 0 }, size_t{ 0 }, n);
+            return;
+        }
+
+        std::vector<std::thread> threads;
+        threads.reserve(workers - 1);
+        for (size_t c = 1; c < workers; ++c) {
+            threads.emplace_back([&fn, n, workers, c]() {
+                fn(c, chunkBegin(n, workers, c), chunkBegin(n, workers, c + 1));
+            });
+        }
+
+        fn(size_t{ 0 }, size_t{ 0 }, chunkBegin(n, workers, 1));
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Sum value(i) for i in [0, n): each worker adds up its own chunk, then the chunk sums are added in order
+    template <typename Value>
+    double sum(size_t n, size_t workers, Value value) {
+        std::vector<double> partial(workers, 0.0);
+        run(n, workers, [&](size_t chunk, size_t begin, size_t end) {
+            double chunkSum = 0.0;
+            for (size_t i = begin; i < end; ++i) {
+                chunkSum += value(i);
+            }
+            partial[chunk] = chunkSum;
+        });
+
+        double total = 0.0;
+        for (double chunkSum : partial) {
+            total += chunkSum;
+        }
+        return total;
+    }
+}
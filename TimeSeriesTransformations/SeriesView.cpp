@@ -0,0 +1,220 @@
+#include "SeriesView.h"
+#include "TimeSeriesTransformations.h"
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+
+// Constructor for a view of parent entries [first, last)
+SeriesView::SeriesView(const TimeSeriesTransformations& parent, size_t first, size_t last)
+    : parent(&parent), first(first), last(last) {
+    if (first > last || last > parent.storage->P3data.size()) {
+        throw std::out_of_range("Invalid view range.");
+    }
+}
+
+// Get an entry of the parent's data
+const std::pair<int, double>& SeriesView::at(size_t i) const {
+    return parent->storage->P3data[i];
+}
+
+// Number of prices, or of increments, in the view
+size_t SeriesView::valueCount(bool increments) const {
+    size_t n = last - first;
+    return increments ? (n < 2 ? 0 : n - 1) : n;
+}
+
+// Price at offset i, or the increment from offset i to i + 1
+double SeriesView::value(size_t i, bool increments) const {
+    return increments ? at(i + 1).second - at(i).second : at(i).second;
+}
+
+// Summarize the viewed prices or increments, combining the parent's block summaries
+SummaryStatistics SeriesView::summary(bool increments) const {
+    const std::pair<int, double>* data = parent->storage->P3data.data();
+    if (increments) {
+        return parent->summaryIndex().increments(data, first, first + valueCount(true));
+    }
+    return parent->summaryIndex().prices(data, first, last);
+}
+
+// Calculate the mean of the viewed prices
+bool SeriesView::mean(double* meanValue) const {
+    if (valueCount(false) == 0) {
+        std::cerr << "Empty vector!!" << std::endl;
+        *meanValue = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+
+    *meanValue = summary(false).mean();
+    return true;
+}
+
+// Calculate the standard deviation of the viewed prices
+bool SeriesView::standardDeviation(double* standardDeviationValue) const {
+    if (valueCount(false) == 0) {
+        std::cerr << "Empty vector!!" << std::endl;
+        *standardDeviationValue = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+
+    *standardDeviationValue = summary(false).standardDeviation();
+    return true;
+}
+
+// Calculate the mean of the viewed increments
+bool SeriesView::computeIncrementMean(double* meanValue) const {
+    if (valueCount(true) == 0) {
+        std::cerr << "Not enough data to compute increments." << std::endl;
+        *meanValue = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+
+    *meanValue = summary(true).mean();
+    return true;
+}
+
+// Calculate the standard deviation of the viewed increments
+bool SeriesView::computeIncrementStandardDeviation(double* standardDeviationValue) const {
+    if (valueCount(true) == 0) {
+        std::cerr << "Not enough data to compute increments." << std::endl;
+        *standardDeviationValue = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+
+    *standardDeviationValue = summary(true).standardDeviation();
+    return true;
+}
+
+// Print the viewed share prices on a specific date
+std::string SeriesView::printSharePricesOnDate(std::string date) const {
+    time_t unix = TimeSeriesTransformations::truncData(date);
+    std::string sharePrices;
+
+    for (size_t i = first; i < last; ++i) {
+        if (TimeSeriesTransformations::truncUnix(static_cast<time_t>(at(i).first)) == unix) {
+            sharePrices += std::to_string(at(i).second) + '\n';
+        }
+    }
+
+    std::cout << "SharePrices on the " + date + " are:" << std::endl << sharePrices << std::endl;
+    return sharePrices;
+}
+
+// Print the viewed increments on a specific date
+std::string SeriesView::printIncrementsOnDate(std::string date) const {
+    time_t unix = TimeSeriesTransformations::truncData(date);
+    std::string increments;
+
+    for (size_t i = first; i < first + valueCount(true); ++i) {
+        if (TimeSeriesTransformations::truncUnix(static_cast<time_t>(at(i).first)) == unix) {
+            increments += std::to_string(value(i, true)) + '\n';
+        }
+    }
+
+    std::cout << "Increments on the " + date + " are:" << std::endl << increments << std::endl;
+    return increments;
+}
+
+// Find the greatest increment in the view, returning the date it starts at
+bool SeriesView::findGreatestIncrements(std::string* date, double* price_increment) const {
+    int time;
+    if (!findGreatestIncrements(&time, price_increment)) {
+        return false;
+    }
+
+    *date = TimeSeriesTransformations::unixToDateTime(static_cast<time_t>(time));
+    return true;
+}
+
+// Find the greatest increment in the view, returning the Unix time it starts at
+bool SeriesView::findGreatestIncrements(int* time, double* price_increment) const {
+    if (first == last) {
+        *price_increment = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+
+    // Query the parent's range-max tree; ties keep the first increment, as std::max_element does
+    const IncrementMaxTree& tree = parent->incrementMaxTree();
+    size_t best = tree.maxIncrement(first, first + valueCount(true));
+    if (best == IncrementMaxTree::npos) {
+        return false;
+    }
+
+    *time = at(best).first;
+    *price_increment = tree.increment(best);
+    return true;
+}
+
+// Get the price at a specific date by binary search on time
+bool SeriesView::getPriceAtDate(const std::string date, double* value) const {
+    int unix = static_cast<int>(TimeSeriesTransformations::dateTimeToUnix(date));
+    size_t i = parent->lowerBound(unix, first, last);
+
+    if (i != last && at(i).first == unix) {
+        *value = at(i).second;
+        return true;
+    }
+
+    *value = std::numeric_limits<double>::quiet_NaN();
+    return false;
+}
+
+// Narrow the view to entries between two dates (inclusive)
+SeriesView SeriesView::view(std::string from, std::string to) const {
+    int fromUnix = static_cast<int>(TimeSeriesTransformations::dateTimeToUnix(from));
+    int toUnix = static_cast<int>(TimeSeriesTransformations::dateTimeToUnix(to));
+    size_t begin = parent->lowerBound(fromUnix, first, last);
+    size_t end = std::max(begin, parent->upperBound(toUnix, first, last));
+    return SeriesView(*parent, begin, end);
+}
+
+// Copy the viewed entries into a new, owning series
+TimeSeriesTransformations SeriesView::toSeries() const {
+    return TimeSeriesTransformations(getTime(), getPrice(), parent->getName());
+}
+
+// Get the number of viewed observations
+int SeriesView::count() const {
+    return static_cast<int>(last - first);
+}
+
+// Get the offset of the first viewed entry in the parent's data
+size_t SeriesView::begin() const {
+    return first;
+}
+
+// Get the offset one past the last viewed entry in the parent's data
+size_t SeriesView::end() const {
+    return last;
+}
+
+// Get the viewed price values
+std::vector<double> SeriesView::getPrice() const {
+    std::vector<double> price;
+    price.reserve(last - first);
+    for (size_t i = first; i < last; ++i) {
+        price.push_back(at(i).second);
+    }
+    return price;
+}
+
+// Get the viewed time values
+std::vector<int> SeriesView::getTime() const {
+    std::vector<int> time;
+    time.reserve(last - first);
+    for (size_t i = first; i < last; ++i) {
+        time.push_back(at(i).first);
+    }
+    return time;
+}
+
+// Get the increments between consecutive viewed prices
+std::vector<double> SeriesView::getIncrements() const {
+    std::vector<double> increments;
+    increments.reserve(valueCount(true));
+    for (size_t i = first; i < first + valueCount(true); ++i) {
+        increments.push_back(value(i, true));
+    }
+    return increments;
+}
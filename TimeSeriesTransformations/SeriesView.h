@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include "BlockSummaryIndex.h"
+
+class TimeSeriesTransformations;
+
+// Non-owning, read-only window onto a contiguous time range of a TimeSeriesTransformations.
+// A view stores offsets into its parent's sorted data, so creating one copies nothing, and its
+// statistics are combined from the parent's block summaries.
+// Statistics of a range inside one block match those of a filtered copy exactly. Ranges spanning
+// blocks add the per-block sums, so their means differ from the filtered copy by the summation
+// rounding bound given for ExecutionPolicy in TimeSeriesTransformations.h. Their variances merge the
+// per-block squared deviations pairwise (Chan, Golub & LeVeque), which rounds the shift between block
+// means into each merge: for n values the relative difference is at most about
+// n * DBL_EPSILON * sqrt(1 + mean^2 / variance), so accuracy drops as the spread shrinks against the
+// price level, and the standard deviation differs by half that.
+// Like an iterator, a view is invalidated by any change to its parent.
+class SeriesView {
+public:
+    SeriesView(const TimeSeriesTransformations& parent, size_t first, size_t last);
+
+    // Statistical functions
+    bool mean(double* meanValue) const;
+    bool standardDeviation(double* standardDeviationValue) const;
+    bool computeIncrementMean(double* meanValue) const;
+    bool computeIncrementStandardDeviation(double* standardDeviationValue) const;
+
+    // Print functions
+    std::string printSharePricesOnDate(std::string date) const;
+    std::string printIncrementsOnDate(std::string date) const;
+
+    // Utility functions
+    bool findGreatestIncrements(std::string* date, double* price_increment) const;
+    bool findGreatestIncrements(int* time, double* price_increment) const;
+    bool getPriceAtDate(const std::string date, double* value) const;
+
+    // Narrow the view to entries between two dates (inclusive)
+    SeriesView view(std::string from, std::string to) const;
+
+    // Copy the viewed entries into a new, owning series
+    TimeSeriesTransformations toSeries() const;
+
+    // Getters
+    int count() const;
+    size_t begin() const;
+    size_t end() const;
+    std::vector<double> getPrice() const;
+    std::vector<int> getTime() const;
+    std::vector<double> getIncrements() const;
+
+private:
+    const TimeSeriesTransformations* parent; // Series being viewed
+    size_t first; // Offset of the first viewed entry in the parent's data
+    size_t last; // Offset one past the last viewed entry
+
+    // Private helpers; `increments` selects the increments between consecutive prices instead of the prices
+    const std::pair<int, double>& at(size_t i) const;
+    size_t valueCount(bool increments) const;
+    double value(size_t i, bool increments) const;
+    SummaryStatistics summary(bool increments) const;
+};
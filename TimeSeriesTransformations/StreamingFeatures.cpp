@@ -0,0 +1,135 @@
+#include "StreamingFeatures.h"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// Constructor
+StreamingFeatures::StreamingFeatures(double alpha, bool keepHistory, std::pmr::memory_resource* resource)
+    : alpha(alpha),
+      keepHistory(keepHistory),
+      logReturnValues(resource),
+      percentReturnValues(resource),
+      meanValues(resource),
+      volatilityValues(resource),
+      zScoreValues(resource) {
+    if (!(alpha > 0.0 && alpha <= 1.0)) {
+        throw std::invalid_argument("EWMA alpha must be in (0, 1].");
+    }
+    clear();
+}
+
+// Update the running state with the next price; only the volatility needs the log return of every
+// tick, so the other latest features are derived from the state when read
+void StreamingFeatures::add(double price) {
+    if (observations++ == 0) {
+        mean = price;
+        lastPrice = price;
+        if (keepHistory) {
+            meanValues.push_back(price);
+            zScoreValues.push_back(std::numeric_limits<double>::quiet_NaN());
+        }
+        return;
+    }
+
+    previousPrice = lastPrice;
+    lastPrice = price;
+    double logReturn = std::log(price / previousPrice);
+
+    // RiskMetrics-style volatility, seeded with the first squared return
+    returnVariance = observations == 2
+        ? logReturn * logReturn
+        : (1.0 - alpha) * returnVariance + alpha * logReturn * logReturn;
+
+    // Incremental exponentially weighted mean and variance (West's update)
+    double delta = price - mean;
+    mean += alpha * delta;
+    variance = (1.0 - alpha) * (variance + alpha * delta * delta);
+
+    if (keepHistory) {
+        logReturnValues.push_back(logReturn);
+        percentReturnValues.push_back(percentReturn());
+        volatilityValues.push_back(std::sqrt(returnVariance));
+        meanValues.push_back(mean);
+        zScoreValues.push_back(zScore());
+    }
+}
+
+// Remove all prices, releasing the history
+void StreamingFeatures::clear() {
+    observations = 0;
+    previousPrice = 0.0;
+    lastPrice = 0.0;
+    mean = 0.0;
+    variance = 0.0;
+    returnVariance = 0.0;
+    for (auto* values : { &logReturnValues, &percentReturnValues, &meanValues, &volatilityValues, &zScoreValues }) {
+        values->clear();
+        values->shrink_to_fit();
+    }
+}
+
+// Get the latest log return
+double StreamingFeatures::logReturn() const {
+    return observations > 1 ? std::log(lastPrice / previousPrice) : std::numeric_limits<double>::quiet_NaN();
+}
+
+// Get the latest percentage return
+double StreamingFeatures::percentReturn() const {
+    return observations > 1 ? 100.0 * (lastPrice / previousPrice - 1.0) : std::numeric_limits<double>::quiet_NaN();
+}
+
+// Get the latest exponentially weighted mean
+double StreamingFeatures::ewmaMean() const {
+    return observations > 0 ? mean : std::numeric_limits<double>::quiet_NaN();
+}
+
+// Get the latest exponentially weighted volatility
+double StreamingFeatures::ewmaVolatility() const {
+    return observations > 1 ? std::sqrt(returnVariance) : std::numeric_limits<double>::quiet_NaN();
+}
+
+// Get the latest z-score
+double StreamingFeatures::zScore() const {
+    return observations > 1 && variance > 0.0
+        ? (lastPrice - mean) / std::sqrt(variance) : std::numeric_limits<double>::quiet_NaN();
+}
+
+// Get the log returns
+const std::pmr::vector<double>& StreamingFeatures::logReturnHistory() const {
+    return logReturnValues;
+}
+
+// Get the percentage returns
+const std::pmr::vector<double>& StreamingFeatures::percentReturnHistory() const {
+    return percentReturnValues;
+}
+
+// Get the exponentially weighted means
+const std::pmr::vector<double>& StreamingFeatures::ewmaMeanHistory() const {
+    return meanValues;
+}
+
+// Get the exponentially weighted volatilities
+const std::pmr::vector<double>& StreamingFeatures::ewmaVolatilityHistory() const {
+    return volatilityValues;
+}
+
+// Get the z-scores
+const std::pmr::vector<double>& StreamingFeatures::zScoreHistory() const {
+    return zScoreValues;
+}
+
+// Get the number of prices added
+size_t StreamingFeatures::count() const {
+    return observations;
+}
+
+// Get the weight of the newest value
+double StreamingFeatures::getAlpha() const {
+    return alpha;
+}
+
+// Whether every price's features are kept
+bool StreamingFeatures::keepsHistory() const {
+    return keepHistory;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <memory_resource>
+
+// Features of a price stream, updated in O(1) as each price arrives. Only the running state is kept,
+// from which the features of the latest price are read in O(1), unless constructed to keep the
+// history: then every feature also has one element per tick, returns and volatility per consecutive
+// pair of prices (like the increments) and the others per price.
+class StreamingFeatures {
+public:
+    static constexpr double defaultAlpha = 0.06;
+
+    // alpha is the weight of the newest value in the exponentially weighted averages (0 < alpha <= 1);
+    // the default matches the RiskMetrics decay of 0.94. The history is allocated from the given
+    // memory resource
+    explicit StreamingFeatures(double alpha = defaultAlpha, bool keepHistory = false,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    void add(double price);
+    void clear();
+
+    // Features of the latest price; NaN until defined (returns and volatility need two prices)
+    double logReturn() const; // log(p[i] / p[i - 1])
+    double percentReturn() const; // 100 * (p[i] / p[i - 1] - 1)
+    double ewmaMean() const; // Exponentially weighted mean of the prices
+    double ewmaVolatility() const; // Exponentially weighted volatility of the log returns
+    double zScore() const; // Distance of the price from the weighted mean, in weighted SDs
+
+    // Features of every price; empty unless the history is kept
+    const std::pmr::vector<double>& logReturnHistory() const;
+    const std::pmr::vector<double>& percentReturnHistory() const;
+    const std::pmr::vector<double>& ewmaMeanHistory() const;
+    const std::pmr::vector<double>& ewmaVolatilityHistory() const;
+    const std::pmr::vector<double>& zScoreHistory() const;
+
+    size_t count() const;
+    double getAlpha() const;
+    bool keepsHistory() const;
+
+private:
+    double alpha;
+    bool keepHistory;
+    size_t observations = 0;
+    double previousPrice = 0.0;
+    double lastPrice = 0.0;
+    double mean = 0.0; // Exponentially weighted mean of the prices
+    double variance = 0.0; // Exponentially weighted variance of the prices
+    double returnVariance = 0.0; // Exponentially weighted variance of the log returns
+    std::pmr::vector<double> logReturnValues;
+    std::pmr::vector<double> percentReturnValues;
+    std::pmr::vector<double> meanValues;
+    std::pmr::vector<double> volatilityValues;
+    std::pmr::vector<double> zScoreValues;
+};
@@ -0,0 +1,222 @@
+#include "TDigest.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// Constructor; larger compression gives more centroids and more accurate quantiles
+TDigest::TDigest(double compression, std::pmr::memory_resource* resource)
+    : compression(compression),
+      centroids(resource),
+      buffer(resource),
+      minimum(std::numeric_limits<double>::infinity()),
+      maximum(-std::numeric_limits<double>::infinity()) {
+    if (!(compression >= 10.0)) {
+        throw std::invalid_argument("t-digest compression must be at least 10.");
+    }
+}
+
+// Add one value
+void TDigest::add(double value) {
+    if (std::isnan(value)) {
+        return;
+    }
+
+    if (buffer.empty()) {
+        buffer.reserve(std::min<size_t>(bufferSize(), 32));
+    }
+    buffer.push_back({ value, 1.0 });
+    ++total;
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+
+    if (buffer.size() >= bufferSize()) {
+        flush();
+    }
+}
+
+// Merge another digest into this one
+void TDigest::merge(const TDigest& other) {
+    if (other.total == 0) {
+        return;
+    }
+    if (&other == this) {
+        // Inserting a vector's own elements into it is undefined, so merge a copy
+        TDigest copy(other);
+        merge(copy);
+        return;
+    }
+
+    buffer.insert(buffer.end(), other.centroids.begin(), other.centroids.end());
+    buffer.insert(buffer.end(), other.buffer.begin(), other.buffer.end());
+    total += other.total;
+    minimum = std::min(minimum, other.minimum);
+    maximum = std::max(maximum, other.maximum);
+    flush();
+}
+
+// Remove all values
+void TDigest::clear() {
+    centroids.clear();
+    buffer.clear();
+    total = 0;
+    minimum = std::numeric_limits<double>::infinity();
+    maximum = -std::numeric_limits<double>::infinity();
+}
+
+// Estimated q-th quantile, interpolating between centroid centres
+double TDigest::quantile(double q) const {
+    if (total == 0 || q < 0.0 || q > 1.0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    std::pmr::vector<Centroid> all = merged();
+    double rank = q * total;
+    if (all.size() == 1 || rank <= all.front().weight / 2) {
+        // Between the minimum and the centre of the first centroid
+        double fraction = all.front().weight > 1 ? rank / (all.front().weight / 2) : 1.0;
+        return minimum + std::min(1.0, fraction) * (all.front().mean - minimum);
+    }
+
+    double before = 0.0; // Weight before the current centroid
+    for (size_t i = 0; i + 1 < all.size(); ++i) {
+        double centre = before + all[i].weight / 2;
+        double nextCentre = before + all[i].weight + all[i + 1].weight / 2;
+        if (rank <= nextCentre) {
+            double fraction = (rank - centre) / (nextCentre - centre);
+            return all[i].mean + fraction * (all[i + 1].mean - all[i].mean);
+        }
+        before += all[i].weight;
+    }
+
+    // Between the centre of the last centroid and the maximum
+    double lastCentre = total - all.back().weight / 2;
+    double fraction = all.back().weight > 1 ? (rank - lastCentre) / (all.back().weight / 2) : 0.0;
+    return all.back().mean + std::min(1.0, fraction) * (maximum - all.back().mean);
+}
+
+// Estimated fraction of values less than or equal to x
+double TDigest::cdf(double x) const {
+    if (total == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (x < minimum) {
+        return 0.0;
+    }
+    if (x >= maximum) {
+        return 1.0;
+    }
+
+    std::pmr::vector<Centroid> all = merged();
+    double before = 0.0;
+    double previousMean = minimum;
+    double previousCentre = 0.0;
+    for (const auto& c : all) {
+        double centre = before + c.weight / 2;
+        if (x < c.mean) {
+            double fraction = c.mean > previousMean ? (x - previousMean) / (c.mean - previousMean) : 1.0;
+            return (previousCentre + fraction * (centre - previousCentre)) / total;
+        }
+        before += c.weight;
+        previousMean = c.mean;
+        previousCentre = centre;
+    }
+
+    double fraction = (x - previousMean) / (maximum - previousMean);
+    return (previousCentre + fraction * (total - previousCentre)) / total;
+}
+
+// Get the number of values added
+size_t TDigest::count() const {
+    return total;
+}
+
+// Get the smallest value added
+double TDigest::min() const {
+    return minimum;
+}
+
+// Get the largest value added
+double TDigest::max() const {
+    return maximum;
+}
+
+// Get the compression parameter
+double TDigest::getCompression() const {
+    return compression;
+}
+
+// Number of values buffered between merges
+size_t TDigest::bufferSize() const {
+    return static_cast<size_t>(compression) * 10;
+}
+
+// Merge the buffered values into the centroids
+void TDigest::flush() {
+    if (buffer.empty()) {
+        return;
+    }
+
+    centroids = merged();
+    buffer.clear();
+}
+
+// Centroids with the buffered values merged in, leaving the digest unchanged
+std::pmr::vector<TDigest::Centroid> TDigest::merged() const {
+    if (buffer.empty()) {
+        return std::pmr::vector<Centroid>(centroids, centroids.get_allocator());
+    }
+
+    std::pmr::vector<Centroid> sortedBuffer(buffer, buffer.get_allocator());
+    std::sort(sortedBuffer.begin(), sortedBuffer.end(), [](const Centroid& a, const Centroid& b) {
+        return a.mean < b.mean;
+    });
+
+    std::pmr::vector<Centroid> all(centroids.size() + sortedBuffer.size(), centroids.get_allocator());
+    std::merge(centroids.begin(), centroids.end(), sortedBuffer.begin(), sortedBuffer.end(), all.begin(),
+        [](const Centroid& a, const Centroid& b) {
+            return a.mean < b.mean;
+        });
+    return mergeCentroids(all);
+}
+
+// Combine neighbouring centroids (sorted by mean) while each stays within the size limit of the
+// k1 scale function, k(q) = compression / (2 pi) * asin(2q - 1): a centroid starting at quantile q0
+// may grow until k(q) - k(q0) = 1
+std::pmr::vector<TDigest::Centroid> TDigest::mergeCentroids(const std::pmr::vector<Centroid>& all) const {
+    const double pi = 3.14159265358979323846;
+    double weight = 0.0;
+    for (const auto& c : all) {
+        weight += c.weight;
+    }
+
+    // Greatest cumulative weight the centroid starting after `before` may reach
+    auto weightLimit = [this, pi, weight](double before) {
+        double k = compression / (2 * pi) * std::asin(2 * std::min(1.0, before / weight) - 1) + 1.0;
+        if (k >= compression / 4) {
+            return weight;
+        }
+        return weight * (std::sin(k * 2 * pi / compression) + 1) / 2;
+    };
+
+    std::pmr::vector<Centroid> result(centroids.get_allocator());
+    result.reserve(static_cast<size_t>(compression));
+    Centroid current = all.front();
+    double before = 0.0; // Weight of the centroids already emitted
+    double limit = weightLimit(before);
+
+    for (size_t i = 1; i < all.size(); ++i) {
+        double proposed = current.weight + all[i].weight;
+        if (before + proposed <= limit) {
+            current.mean += (all[i].mean - current.mean) * all[i].weight / proposed;
+            current.weight = proposed;
+        } else {
+            result.push_back(current);
+            before += current.weight;
+            limit = weightLimit(before);
+            current = all[i];
+        }
+    }
+    result.push_back(current);
+    return result;
+}
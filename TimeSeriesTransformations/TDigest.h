@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <memory_resource>
+
+// Streaming quantile sketch (merging t-digest, Dunning & Ertl). Values are buffered and periodically
+// merged into a sorted list of weighted centroids, kept small near the tails so extreme quantiles stay
+// accurate. Digests built on different threads or series can be merged.
+class TDigest {
+public:
+    static constexpr double defaultCompression = 200.0;
+
+    // The centroids are allocated from the given memory resource
+    explicit TDigest(double compression = defaultCompression,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    void add(double value);
+    void merge(const TDigest& other);
+    void clear();
+
+    // Estimated q-th quantile (0 <= q <= 1); NaN if the digest is empty
+    double quantile(double q) const;
+    // Estimated fraction of values less than or equal to x; NaN if the digest is empty
+    double cdf(double x) const;
+
+    size_t count() const;
+    double min() const;
+    double max() const;
+    double getCompression() const;
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    double compression; // Roughly bounds the number of centroids
+    std::pmr::vector<Centroid> centroids; // Merged centroids, sorted by mean
+    std::pmr::vector<Centroid> buffer; // Values added since the last merge
+    size_t total = 0;
+    double minimum;
+    double maximum;
+
+    size_t bufferSize() const;
+    void flush();
+    std::pmr::vector<Centroid> merged() const;
+    std::pmr::vector<Centroid> mergeCentroids(const std::pmr::vector<Centroid>& all) const;
+};
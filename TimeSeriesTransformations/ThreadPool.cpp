@@ -0,0 +1,85 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+// Start the workers; a queue capacity of 0 means one queued task per worker
+ThreadPool::ThreadPool(size_t threads, size_t queueCapacity)
+    : capacity(queueCapacity > 0 ? queueCapacity : std::max<size_t>(1, threads)) {
+    threads = std::max<size_t>(1, threads);
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this]() { work(); });
+    }
+}
+
+// Finish the queued tasks, then stop the workers
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Queue a task, waiting for room in the queue
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        spaceAvailable.wait(lock, [this]() { return tasks.size() < capacity; });
+        tasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+// Wait until the queue is empty and no task is running
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return tasks.empty() && running == 0; });
+
+    if (failure) {
+        std::exception_ptr rethrown = failure;
+        failure = nullptr;
+        std::rethrow_exception(rethrown);
+    }
+}
+
+// Get the number of worker threads
+size_t ThreadPool::threadCount() const {
+    return workers.size();
+}
+
+// Run tasks until the pool stops and the queue is empty
+void ThreadPool::work() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            ++running;
+        }
+        spaceAvailable.notify_one();
+
+        std::exception_ptr error;
+        try {
+            task();
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+            if (error && !failure) {
+                failure = error;
+            }
+        }
+        idle.notify_all();
+    }
+}
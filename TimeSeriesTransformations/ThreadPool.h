@@ -0,0 +1,41 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running tasks from a bounded queue. submit() blocks while the queue
+// is full, so a producer can never get more than `queueCapacity` tasks ahead of the workers.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads, size_t queueCapacity = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task, waiting for room in the queue
+    void submit(std::function<void()> task);
+    // Wait until every submitted task has finished; rethrows the first exception a task threw
+    void wait();
+
+    size_t threadCount() const;
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    size_t capacity; // Maximum number of queued tasks
+    size_t running = 0; // Tasks taken from the queue but not finished
+    bool stopping = false;
+    std::exception_ptr failure;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable spaceAvailable;
+    std::condition_variable idle;
+
+    void work();
+};
@@ -7,12 +7,112 @@
 #include <iomanip>
 #include <stdexcept>
 #include <algorithm>
+#include <iterator>
 #include <limits>
+#include <cmath>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "ParallelChunks.h"
+
+namespace {
+    // Reads a file in fixed-size blocks on a background thread, alternating between two
+    // buffers so the next block comes off the disk while the caller parses the current one
+    class DoubleBufferedReader {
+    public:
+        DoubleBufferedReader(std::ifstream& file, size_t blockSize) : file(file) {
+            for (auto& buffer : buffers) {
+                buffer.data.resize(blockSize);
+            }
+            reader = std::thread([this]() { readBlocks(); });
+        }
+
+        ~DoubleBufferedReader() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            changed.notify_all();
+            reader.join();
+        }
+
+        // Hand back the previous block and wait for the next one; returns false at end of file
+        bool next(const char** data, size_t* size) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (holding) {
+                buffers[consumer].full = false;
+                consumer ^= 1;
+                changed.notify_all();
+            }
+
+            changed.wait(lock, [this]() { return buffers[consumer].full; });
+            holding = true;
+
+            if (failed) {
+                throw std::runtime_error("Error while reading file");
+            }
+
+            *data = buffers[consumer].data.data();
+            *size = buffers[consumer].size;
+            return *size > 0;
+        }
+
+    private:
+        struct Buffer {
+            std::vector<char> data;
+            size_t size = 0;
+            bool full = false;
+        };
+
+        // Fill the buffers in turn until a read returns no data
+        void readBlocks() {
+            for (int producer = 0;; producer ^= 1) {
+                Buffer& buffer = buffers[producer];
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&]() { return !buffer.full || stopping; });
+                    if (stopping) {
+                        return;
+                    }
+                }
+
+                // The buffer belongs to this thread until it is marked full
+                file.read(buffer.data.data(), static_cast<std::streamsize>(buffer.data.size()));
+                size_t size = static_cast<size_t>(file.gcount());
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    buffer.size = size;
+                    buffer.full = true;
+                    failed = file.bad();
+                }
+                changed.notify_all();
+
+                if (size == 0) {
+                    return;
+                }
+            }
+        }
+
+        std::ifstream& file;
+        Buffer buffers[2];
+        int consumer = 0;
+        bool holding = false;
+        bool stopping = false;
+        bool failed = false;
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::thread reader;
+    };
+}
 
 // Constructor to load data from a CSV file
-TimeSeriesTransformations::TimeSeriesTransformations(const std::string& filenameandpath) {
+TimeSeriesTransformations::TimeSeriesTransformations(const std::string& filenameandpath)
+    : storage(makeStorage(std::pmr::get_default_resource())) {
     std::ifstream csv(filenameandpath);
-    double five_dp = std::pow(10, decimalPlaces);
 
     if (!csv.is_open()) {
         throw std::runtime_error("Unable to open file " + filenameandpath);
@@ -22,101 +122,250 @@ TimeSeriesTransformations::TimeSeriesTransformations(const std::string& filename
         // Read the header line
         std::string header;
         std::getline(csv, header); // Assume the header contains "TIMESTAMP,ShareX"
-
-        // Extract the name part (e.g., "ShareX")
-        size_t commaPos = header.find(',');
-        if (commaPos != std::string::npos) {
-            _name = header.substr(commaPos + 1); // Extract everything after the comma
-        } else {
-            _name = header; // If no comma, use the entire header
-        }
+        readCsvHeader(header);
 
         std::string line;
         while (std::getline(csv, line)) {
-            std::stringstream iss(line);
-            std::string timeStr, priceStr;
-
-            // Parse time and price from the CSV line
-            if (std::getline(iss, timeStr, this->getSeparator()) && std::getline(iss, priceStr)) {
-                try {
-                    int time = std::stoi(timeStr);
-                    double price = std::stod(priceStr);
-
-                    // Round the price to 5 decimal places
-                    price = std::round(price * five_dp) / five_dp;
-
-                    // Add the data point
-                    P3data.push_back({ time, price });
-                } catch (const std::exception&) {
-                    throw std::runtime_error("Invalid data format in file: " + filenameandpath);
-                }
-            }
+            appendCsvLine(line, filenameandpath);
         }
 
         // Sort the data by time
-        std::sort(P3data.begin(), P3data.end());
-        observations = P3data.size();
+        std::sort(storage->P3data.begin(), storage->P3data.end());
+        dataChanged(0);
         csv.close();
     }
 }
 
+// Take the series name from a CSV header line
+void TimeSeriesTransformations::readCsvHeader(const std::string& header) {
+    // Extract the name part (e.g., "ShareX")
+    size_t commaPos = header.find(',');
+    if (commaPos != std::string::npos) {
+        _name = header.substr(commaPos + 1); // Extract everything after the comma
+    } else {
+        _name = header; // If no comma, use the entire header
+    }
+}
+
+// Parse a "time,price" CSV line and append it to the (unsorted) data
+void TimeSeriesTransformations::appendCsvLine(const std::string& line, const std::string& filenameandpath) {
+    double five_dp = std::pow(10, decimalPlaces);
+    std::stringstream iss(line);
+    std::string timeStr, priceStr;
+
+    // Parse time and price from the CSV line
+    if (std::getline(iss, timeStr, this->getSeparator()) && std::getline(iss, priceStr)) {
+        try {
+            int time = std::stoi(timeStr);
+            double price = std::stod(priceStr);
+
+            // Round the price to 5 decimal places
+            price = std::round(price * five_dp) / five_dp;
+
+            // Add the data point
+            storage->P3data.push_back({ time, price });
+        } catch (const std::exception&) {
+            throw std::runtime_error("Invalid data format in file: " + filenameandpath);
+        }
+    }
+}
+
+// Load a CSV file on a background thread; progress is reported in bytes parsed
+std::future<TimeSeriesTransformations> TimeSeriesTransformations::loadAsync(const std::string& filenameandpath,
+    ProgressCallback progress, CancellationToken cancel) {
+    return std::async(std::launch::async, [filenameandpath, progress, cancel]() {
+        std::ifstream csv(filenameandpath, std::ios::binary);
+
+        if (!csv.is_open()) {
+            throw std::runtime_error("Unable to open file " + filenameandpath);
+        }
+
+        std::error_code error;
+        size_t totalBytes = static_cast<size_t>(std::filesystem::file_size(filenameandpath, error));
+        size_t bytesDone = 0;
+
+        TimeSeriesTransformations result;
+        bool headerRead = false;
+        std::string pending; // Partial line carried over from the previous block
+
+        auto handleLine = [&](const std::string& line) {
+            if (headerRead) {
+                result.appendCsvLine(line, filenameandpath);
+            } else {
+                result.readCsvHeader(line);
+                headerRead = true;
+            }
+        };
+
+        DoubleBufferedReader reader(csv, readBlockSize);
+        const char* data;
+        size_t size;
+
+        while (reader.next(&data, &size)) {
+            if (cancel && *cancel) {
+                throw std::runtime_error("Loading cancelled: " + filenameandpath);
+            }
+
+            const char* lineStart = data;
+            const char* end = data + size;
+            while (const char* newline = static_cast<const char*>(std::memchr(lineStart, '\n', end - lineStart))) {
+                pending.append(lineStart, newline);
+                handleLine(pending);
+                pending.clear();
+                lineStart = newline + 1;
+            }
+            pending.append(lineStart, end);
+
+            bytesDone += size;
+            if (progress) {
+                progress(bytesDone, std::max(bytesDone, totalBytes));
+            }
+        }
+
+        if (!pending.empty()) {
+            handleLine(pending);
+        }
+
+        // Sort the data by time
+        std::sort(result.storage->P3data.begin(), result.storage->P3data.end());
+        result.dataChanged(0);
+        return result;
+    });
+}
+
 // Default constructor
-TimeSeriesTransformations::TimeSeriesTransformations() {}
+TimeSeriesTransformations::TimeSeriesTransformations()
+    : storage(makeStorage(std::pmr::get_default_resource())) {}
+
+// Constructor for an empty series whose storage comes from the given memory resource
+TimeSeriesTransformations::TimeSeriesTransformations(std::pmr::memory_resource* resource)
+    : storage(makeStorage(resource)), _name(resource) {}
 
 // Constructor to initialize with time and price vectors
 TimeSeriesTransformations::TimeSeriesTransformations(const std::vector<int>& time,
-    const std::vector<double>& price, std::string name) {
+    const std::vector<double>& price, std::string name)
+    : TimeSeriesTransformations(time, price, name, std::pmr::get_default_resource()) {}
+
+// Constructor to initialize with time and price vectors, allocating from the given memory resource
+// (including the name, which is copied straight into the resource)
+TimeSeriesTransformations::TimeSeriesTransformations(const std::vector<int>& time,
+    const std::vector<double>& price, std::string_view name, std::pmr::memory_resource* resource)
+    : storage(makeStorage(resource)), _name(name, resource) {
     if (time.size() != price.size()) {
         throw std::runtime_error("Error: Incomparable sizes of time and price vectors.");
     }
 
-    _name = name;
-    observations = time.size();
-
-    for (int i = 0; i < observations; ++i) {
-        P3data.push_back({ time[i], price[i] });
+    storage->P3data.reserve(time.size());
+    for (size_t i = 0; i < time.size(); ++i) {
+        storage->P3data.push_back({ time[i], price[i] });
     }
 
     // Sort the data by time
-    std::sort(P3data.begin(), P3data.end());
+    std::sort(storage->P3data.begin(), storage->P3data.end());
+    dataChanged(0);
 }
 
-// Copy constructor
-TimeSeriesTransformations::TimeSeriesTransformations(const TimeSeriesTransformations& t) {
-    P3data = t.P3data;
-    _name = t._name;
-    observations = t.observations;
-}
+// Copy constructor; the copy allocates from the default resource
+TimeSeriesTransformations::TimeSeriesTransformations(const TimeSeriesTransformations& t)
+    : TimeSeriesTransformations(t, std::pmr::get_default_resource()) {}
+
+// Copy constructor allocating the copy from the given memory resource. The data is shared with t
+// until one of them changes it when t allocates from the same resource, and copied otherwise
+TimeSeriesTransformations::TimeSeriesTransformations(const TimeSeriesTransformations& t,
+    std::pmr::memory_resource* resource)
+    : storage(shareStorage(t, resource)), _name(t._name, resource) {}
 
-// Assignment operator
+// Assignment operator; the series keeps allocating from its own resource
 TimeSeriesTransformations& TimeSeriesTransformations::operator=(const TimeSeriesTransformations& t) {
     if (this != &t) {
-        P3data = t.P3data;
+        storage = shareStorage(t, getResource());
         _name = t._name;
-        observations = t.observations;
     }
     return *this;
 }
 
-// Equality operator
+// Equality operator; series sharing their data are equal without comparing it, and series with
+// different content hashes are unequal
 bool TimeSeriesTransformations::operator==(const TimeSeriesTransformations& t) const {
-    return (P3data == t.P3data);
+    if (storage == t.storage) {
+        return true;
+    }
+    return hash() == t.hash() && storage->P3data == t.storage->P3data;
+}
+
+// Get the content hash of the entries
+uint64_t TimeSeriesTransformations::hash() const {
+    return summaryIndex().hash();
+}
+
+// Walk both sorted series together, pairing equal timestamps in order
+TimeSeriesTransformations::Diff TimeSeriesTransformations::diff(const TimeSeriesTransformations& other) const {
+    Diff result;
+    if (*this == other) {
+        return result;
+    }
+
+    const auto& a = storage->P3data;
+    const auto& b = other.storage->P3data;
+    size_t i = 0, j = 0;
+
+    while (i < a.size() && j < b.size()) {
+        // Matching timestamps are the common case, so check runs of them in a tight loop
+        while (i < a.size() && j < b.size() && a[i].first == b[j].first) {
+            if (a[i].second != b[j].second) {
+                result.changed.push_back(a[i].first);
+            }
+            ++i;
+            ++j;
+        }
+
+        if (i < a.size() && j < b.size()) {
+            if (a[i].first < b[j].first) {
+                result.removed.push_back(a[i++].first);
+            } else {
+                result.inserted.push_back(b[j++].first);
+            }
+        }
+    }
+
+    for (; i < a.size(); ++i) {
+        result.removed.push_back(a[i].first);
+    }
+    for (; j < b.size(); ++j) {
+        result.inserted.push_back(b[j].first);
+    }
+    return result;
+}
+
+// Check whether a diff found no differences
+bool TimeSeriesTransformations::Diff::empty() const {
+    return inserted.empty() && removed.empty() && changed.empty();
 }
 
 // Get the name of the time series
 std::string TimeSeriesTransformations::getName() const {
-    return _name;
+    return std::string(_name);
+}
+
+// Get the memory resource the series allocates from
+std::pmr::memory_resource* TimeSeriesTransformations::getResource() const {
+    return storage->P3data.get_allocator().resource();
+}
+
+// Check whether this series shares its data with t (copies do until one of them changes)
+bool TimeSeriesTransformations::sharesDataWith(const TimeSeriesTransformations& t) const {
+    return storage == t.storage;
 }
 
 // Get the number of observations
 int TimeSeriesTransformations::count() const {
-    return static_cast<int>(P3data.size());
+    return static_cast<int>(storage->P3data.size());
 }
 
 // Get the time values
 std::vector<int> TimeSeriesTransformations::getTime() const {
     std::vector<int> time;
-    for (const auto& entry : P3data) {
+    for (const auto& entry : storage->P3data) {
         time.push_back(entry.first);
     }
     return time;
@@ -125,7 +374,7 @@ std::vector<int> TimeSeriesTransformations::getTime() const {
 // Get the price values
 std::vector<double> TimeSeriesTransformations::getPrice() const {
     std::vector<double> price;
-    for (const auto& entry : P3data) {
+    for (const auto& entry : storage->P3data) {
         price.push_back(entry.second);
     }
     return price;
@@ -138,8 +387,8 @@ std::string TimeSeriesTransformations::unixToDateTime(const time_t& unix) {
     // Use gmtime_s on Windows to get UTC time
     gmtime_s(&timeStruct, &unix);
 #else
-    // Use gmtime on Unix-like systems to get UTC time
-    timeStruct = *gmtime(&unix);
+    // Use gmtime_r on Unix-like systems so concurrent callers do not share a static buffer
+    gmtime_r(&unix, &timeStruct);
 #endif
 
     // Format the date and time as "YYYY-MM-DD HH:MM:SS"
@@ -156,9 +405,6 @@ std::string TimeSeriesTransformations::unixToDateTime(const time_t& unix) {
 
 // Convert a date and time string to Unix time
 time_t TimeSeriesTransformations::dateTimeToUnix(const std::string& date) {
-    // Debug output
-    std::cout << "Parsing date: " << date << std::endl;
-
     // Validate the input string length
     if (date.length() != 19) { // "YYYY-MM-DD HH:MM:SS" is 19 characters
         throw std::invalid_argument("Invalid date format: " + date);
@@ -211,8 +457,8 @@ int TimeSeriesTransformations::truncUnix(const time_t& unix) {
     // Use gmtime_s on Windows
     gmtime_s(&timeStruct, &unix);
 #else
-    // Use gmtime on Unix-like systems
-    timeStruct = *gmtime(&unix);
+    // Use gmtime_r on Unix-like systems so concurrent callers do not share a static buffer
+    gmtime_r(&unix, &timeStruct);
 #endif
 
     // Set the time to 00:00:00
@@ -291,12 +537,12 @@ bool TimeSeriesTransformations::standardDeviation(double* standardDeviationValue
 // Calculate the increments (differences between consecutive prices)
 std::vector<double> TimeSeriesTransformations::computeIncrements() const {
     std::vector<double> increments;
-    if (P3data.size() < 2) {
+    if (storage->P3data.size() < 2) {
         return increments; // Not enough data to compute increments
     }
 
-    for (size_t i = 1; i < P3data.size(); ++i) {
-        increments.push_back(P3data[i].second - P3data[i - 1].second);
+    for (size_t i = 1; i < storage->P3data.size(); ++i) {
+        increments.push_back(storage->P3data[i].second - storage->P3data[i - 1].second);
     }
 
     return increments;
@@ -340,6 +586,250 @@ bool TimeSeriesTransformations::computeIncrementStandardDeviation(double* standa
     }
 }
 
+// Number of worker threads to use for n entries under an execution policy
+size_t TimeSeriesTransformations::workersFor(ExecutionPolicy policy, size_t n) const {
+    if (policy == ExecutionPolicy::Sequential) {
+        return 1;
+    }
+    return ParallelChunks::workerCount(n, parallelGrainSize);
+}
+
+// Calculate the mean of value(i) for i in [0, n) from per-thread partial sums
+template <typename Value>
+double TimeSeriesTransformations::parallelMean(size_t n, size_t workers, Value value) {
+    return ParallelChunks::sum(n, workers, value) / n;
+}
+
+// Calculate the standard deviation of value(i) for i in [0, n) with two parallel passes
+template <typename Value>
+double TimeSeriesTransformations::parallelSD(size_t n, size_t workers, Value value) {
+    double mean = parallelMean(n, workers, value);
+    double sumSquares = ParallelChunks::sum(n, workers, [&value, mean](size_t i) {
+        return (value(i) - mean) * (value(i) - mean);
+    });
+    return std::sqrt(sumSquares / (n - 1));
+}
+
+// Calculate the mean of the time series prices under an execution policy
+bool TimeSeriesTransformations::mean(ExecutionPolicy policy, double* meanValue) const {
+    if (policy == ExecutionPolicy::Sequential) {
+        return mean(meanValue);
+    }
+
+    try {
+        if (storage->P3data.empty()) {
+            throw std::runtime_error("Empty vector!!");
+        }
+
+        *meanValue = parallelMean(storage->P3data.size(), workersFor(policy, storage->P3data.size()),
+            [this](size_t i) { return storage->P3data[i].second; });
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        *meanValue = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+}
+
+// Calculate the standard deviation of the time series prices under an execution policy
+bool TimeSeriesTransformations::standardDeviation(ExecutionPolicy policy, double* standardDeviationValue) const {
+    if (policy == ExecutionPolicy::Sequential) {
+        return standardDeviation(standardDeviationValue);
+    }
+
+    try {
+        if (storage->P3data.empty()) {
+            throw std::runtime_error("Empty vector!!");
+        }
+
+        *standardDeviationValue = parallelSD(storage->P3data.size(), workersFor(policy, storage->P3data.size()),
+            [this](size_t i) { return storage->P3data[i].second; });
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        *standardDeviationValue = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+}
+
+// Calculate the increments under an execution policy, each thread filling its own part of the result
+std::vector<double> TimeSeriesTransformations::computeIncrements(ExecutionPolicy policy) const {
+    if (policy == ExecutionPolicy::Sequential) {
+        return computeIncrements();
+    }
+
+    std::vector<double> increments(storage->P3data.size() < 2 ? 0 : storage->P3data.size() - 1);
+    ParallelChunks::run(increments.size(), workersFor(policy, increments.size()),
+        [this, &increments](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                increments[i] = storage->P3data[i + 1].second - storage->P3data[i].second;
+            }
+        });
+
+    return increments;
+}
+
+std::vector<double> TimeSeriesTransformations::getIncrements(ExecutionPolicy policy) const {
+    return computeIncrements(policy);
+}
+
+// Calculate the mean of the increments under an execution policy, without storing them
+bool TimeSeriesTransformations::computeIncrementMean(ExecutionPolicy policy, double* meanValue) const {
+    if (policy == ExecutionPolicy::Sequential) {
+        return computeIncrementMean(meanValue);
+    }
+
+    try {
+        if (storage->P3data.size() < 2) {
+            throw std::runtime_error("Not enough data to compute increments.");
+        }
+
+        size_t n = storage->P3data.size() - 1;
+        *meanValue = parallelMean(n, workersFor(policy, n),
+            [this](size_t i) { return storage->P3data[i + 1].second - storage->P3data[i].second; });
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        *meanValue = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+}
+
+// Calculate the standard deviation of the increments under an execution policy, without storing them
+bool TimeSeriesTransformations::computeIncrementStandardDeviation(ExecutionPolicy policy,
+    double* standardDeviationValue) const {
+    if (policy == ExecutionPolicy::Sequential) {
+        return computeIncrementStandardDeviation(standardDeviationValue);
+    }
+
+    try {
+        if (storage->P3data.size() < 2) {
+            throw std::runtime_error("Not enough data to compute increments.");
+        }
+
+        size_t n = storage->P3data.size() - 1;
+        *standardDeviationValue = parallelSD(n, workersFor(policy, n),
+            [this](size_t i) { return storage->P3data[i + 1].second - storage->P3data[i].second; });
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        *standardDeviationValue = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+}
+
+// Estimate the q-th quantile (0 <= q <= 1) of the prices from the price sketch
+bool TimeSeriesTransformations::priceQuantile(double q, double* value) const {
+    refreshSketches();
+
+    try {
+        if (storage->priceSketch.count() == 0) {
+            throw std::runtime_error("Empty vector!!");
+        }
+        if (q < 0.0 || q > 1.0) {
+            throw std::invalid_argument("Quantile must be between 0 and 1.");
+        }
+
+        *value = storage->priceSketch.quantile(q);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        *value = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+}
+
+// Estimate the q-th quantile (0 <= q <= 1) of the increments from the increment sketch
+bool TimeSeriesTransformations::incrementQuantile(double q, double* value) const {
+    refreshSketches();
+
+    try {
+        if (storage->incrementSketch.count() == 0) {
+            throw std::runtime_error("Not enough data to compute increments.");
+        }
+        if (q < 0.0 || q > 1.0) {
+            throw std::invalid_argument("Quantile must be between 0 and 1.");
+        }
+
+        *value = storage->incrementSketch.quantile(q);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        *value = std::numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+}
+
+// Estimate the value at risk of one increment: the loss exceeded with probability 1 - confidence
+bool TimeSeriesTransformations::valueAtRisk(double confidence, double* value) const {
+    if (!incrementQuantile(1.0 - confidence, value)) {
+        return false;
+    }
+
+    *value = -*value;
+    return true;
+}
+
+// Get the sketch of the prices, e.g. to merge with the sketches of other series
+const TDigest& TimeSeriesTransformations::getPriceSketch() const {
+    refreshSketches();
+    return storage->priceSketch;
+}
+
+// Get the sketch of the increments
+const TDigest& TimeSeriesTransformations::getIncrementSketch() const {
+    refreshSketches();
+    return storage->incrementSketch;
+}
+
+// Get the features of the latest price
+const StreamingFeatures& TimeSeriesTransformations::getFeatures() const {
+    return storage->features;
+}
+
+// Get the features of every price
+const StreamingFeatures& TimeSeriesTransformations::getFeatureHistory() const {
+    refreshFeatureHistory();
+    return storage->featureHistory;
+}
+
+// Get the weight of the newest price in the exponentially weighted features
+double TimeSeriesTransformations::featureSmoothing() const {
+    return storage->features.getAlpha();
+}
+
+// Change the weight of the newest price in the exponentially weighted features, recomputing the
+// latest features; the history is rebuilt when next requested
+void TimeSeriesTransformations::setFeatureSmoothing(double alpha) {
+    StreamingFeatures features(alpha);
+    for (const auto& entry : storage->P3data) {
+        features.add(entry.second);
+    }
+
+    detach();
+    storage->features = features;
+    storage->featureHistory = StreamingFeatures(alpha, true);
+    storage->featureHistoryCurrent = false;
+}
+
+// Count the prices into fixed-width bins
+Histogram TimeSeriesTransformations::priceHistogram(double lower, double upper, size_t bins) const {
+    Histogram histogram(lower, upper, bins);
+    for (const auto& entry : storage->P3data) {
+        histogram.add(entry.second);
+    }
+    return histogram;
+}
+
+// Count the increments into fixed-width bins
+Histogram TimeSeriesTransformations::incrementHistogram(double lower, double upper, size_t bins) const {
+    Histogram histogram(lower, upper, bins);
+    for (size_t i = 1; i < storage->P3data.size(); ++i) {
+        histogram.add(storage->P3data[i].second - storage->P3data[i - 1].second);
+    }
+    return histogram;
+}
+
 // Add a share price at a specific date and time
 void TimeSeriesTransformations::addASharePrice(std::string datetime, double price) {
     time_t unix = dateTimeToUnix(datetime);
@@ -347,81 +837,374 @@ void TimeSeriesTransformations::addASharePrice(std::string datetime, double pric
     double roundedPrice = std::round(price * five_dp) / five_dp;
 
     // Find the correct position to insert the new data point
-    auto it = std::lower_bound(P3data.begin(), P3data.end(), std::make_pair(static_cast<int>(unix), 0.0),
+    detach();
+    auto it = std::lower_bound(storage->P3data.begin(), storage->P3data.end(), std::make_pair(static_cast<int>(unix), 0.0),
         [](const std::pair<int, double>& a, const std::pair<int, double>& b) {
             return a.first < b.first;
         });
 
-    P3data.insert(it, { static_cast<int>(unix), roundedPrice });
-    observations = P3data.size();
+    it = storage->P3data.insert(it, { static_cast<int>(unix), roundedPrice });
+    dataChanged(static_cast<size_t>(it - storage->P3data.begin()));
 }
 
 // Remove an entry at a specific time
 bool TimeSeriesTransformations::removeEntryAtTime(std::string time) {
     time_t unix = dateTimeToUnix(time);
-    size_t initialSize = P3data.size();
-
-    P3data.erase(std::remove_if(P3data.begin(), P3data.end(),
-        [unix](const std::pair<int, double>& entry) {
-            return entry.first == static_cast<int>(unix);
-        }), P3data.end());
 
-    observations = P3data.size();
-    return (initialSize != observations);
+    return removeIf([unix](const std::pair<int, double>& entry) {
+        return entry.first == static_cast<int>(unix);
+    });
 }
 
 // Remove prices greater than a specified value
 bool TimeSeriesTransformations::removePricesGreaterThan(double price) {
-    size_t initialSize = P3data.size();
-
-    P3data.erase(std::remove_if(P3data.begin(), P3data.end(),
-        [price](const std::pair<int, double>& entry) {
-            return entry.second > price;
-        }), P3data.end());
-
-    observations = P3data.size();
-    return (initialSize != observations);
+    return removeIf([price](const std::pair<int, double>& entry) {
+        return entry.second > price;
+    });
 }
 
 // Remove prices lower than a specified value
 bool TimeSeriesTransformations::removePricesLowerThan(double price) {
-    size_t initialSize = P3data.size();
-
-    P3data.erase(std::remove_if(P3data.begin(), P3data.end(),
-        [price](const std::pair<int, double>& entry) {
-            return entry.second < price;
-        }), P3data.end());
-
-    observations = P3data.size();
-    return (initialSize != observations);
+    return removeIf([price](const std::pair<int, double>& entry) {
+        return entry.second < price;
+    });
 }
 
 // Remove prices before a specified date
 bool TimeSeriesTransformations::removePricesBefore(std::string date) {
     time_t unix = dateTimeToUnix(date);
-    size_t initialSize = P3data.size();
-
-    P3data.erase(std::remove_if(P3data.begin(), P3data.end(),
-        [unix](const std::pair<int, double>& entry) {
-            return entry.first < static_cast<int>(unix);
-        }), P3data.end());
 
-    observations = P3data.size();
-    return (initialSize != observations);
+    return removeIf([unix](const std::pair<int, double>& entry) {
+        return entry.first < static_cast<int>(unix);
+    });
 }
 
 // Remove prices after a specified date
 bool TimeSeriesTransformations::removePricesAfter(std::string date) {
     time_t unix = dateTimeToUnix(date);
-    size_t initialSize = P3data.size();
 
-    P3data.erase(std::remove_if(P3data.begin(), P3data.end(),
-        [unix](const std::pair<int, double>& entry) {
-            return entry.first > static_cast<int>(unix);
-        }), P3data.end());
+    return removeIf([unix](const std::pair<int, double>& entry) {
+        return entry.first > static_cast<int>(unix);
+    });
+}
+
+// Remove an entry at a specific time under an execution policy
+bool TimeSeriesTransformations::removeEntryAtTime(ExecutionPolicy policy, std::string time) {
+    time_t unix = dateTimeToUnix(time);
+
+    return removeIf(policy, [unix](const std::pair<int, double>& entry) {
+        return entry.first == static_cast<int>(unix);
+    });
+}
+
+// Remove prices greater than a specified value under an execution policy
+bool TimeSeriesTransformations::removePricesGreaterThan(ExecutionPolicy policy, double price) {
+    return removeIf(policy, [price](const std::pair<int, double>& entry) {
+        return entry.second > price;
+    });
+}
+
+// Remove prices lower than a specified value under an execution policy
+bool TimeSeriesTransformations::removePricesLowerThan(ExecutionPolicy policy, double price) {
+    return removeIf(policy, [price](const std::pair<int, double>& entry) {
+        return entry.second < price;
+    });
+}
+
+// Remove prices before a specified date under an execution policy
+bool TimeSeriesTransformations::removePricesBefore(ExecutionPolicy policy, std::string date) {
+    time_t unix = dateTimeToUnix(date);
+
+    return removeIf(policy, [unix](const std::pair<int, double>& entry) {
+        return entry.first < static_cast<int>(unix);
+    });
+}
+
+// Remove prices after a specified date under an execution policy
+bool TimeSeriesTransformations::removePricesAfter(ExecutionPolicy policy, std::string date) {
+    time_t unix = dateTimeToUnix(date);
+
+    return removeIf(policy, [unix](const std::pair<int, double>& entry) {
+        return entry.first > static_cast<int>(unix);
+    });
+}
+
+// Remove the entries matching a predicate, returning whether any were removed
+template <typename Predicate>
+bool TimeSeriesTransformations::removeIf(Predicate predicate) {
+    auto firstRemoved = std::find_if(storage->P3data.begin(), storage->P3data.end(), predicate);
+    if (firstRemoved == storage->P3data.end()) {
+        return false;
+    }
+
+    size_t from = static_cast<size_t>(firstRemoved - storage->P3data.begin());
+    if (storage.use_count() > 1) {
+        // Copy only the kept entries of shared data, rather than all of it and then removing some
+        std::pmr::vector<std::pair<int, double>> kept(storage->P3data.get_allocator());
+        kept.reserve(storage->P3data.size() - 1);
+        kept.assign(storage->P3data.begin(), firstRemoved);
+        std::remove_copy_if(firstRemoved, storage->P3data.end(), std::back_inserter(kept), predicate);
+        replaceData(kept, from);
+        return true;
+    }
+
+    storage->P3data.erase(std::remove_if(firstRemoved, storage->P3data.end(), predicate), storage->P3data.end());
+    dataChanged(from);
+    return true;
+}
+
+// Remove the entries matching a predicate with a stable parallel compaction: each thread counts the
+// entries its chunk keeps, the counts give each chunk's output offset, then each thread copies its
+// kept entries into place
+template <typename Predicate>
+bool TimeSeriesTransformations::removeIf(ExecutionPolicy policy, Predicate predicate) {
+    size_t workers = workersFor(policy, storage->P3data.size());
+    if (workers <= 1) {
+        return removeIf(predicate);
+    }
+
+    std::vector<size_t> offsets(workers + 1, 0);
+    std::vector<size_t> firstRemoved(workers, storage->P3data.size());
+
+    ParallelChunks::run(storage->P3data.size(), workers, [&](size_t chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (!predicate(storage->P3data[i])) {
+                ++offsets[chunk + 1];
+            } else if (firstRemoved[chunk] == storage->P3data.size()) {
+                firstRemoved[chunk] = i;
+            }
+        }
+    });
+
+    size_t from = *std::min_element(firstRemoved.begin(), firstRemoved.end());
+    if (from == storage->P3data.size()) {
+        return false;
+    }
+
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::pmr::vector<std::pair<int, double>> compacted(offsets[workers], storage->P3data.get_allocator());
+
+    ParallelChunks::run(storage->P3data.size(), workers, [&](size_t chunk, size_t begin, size_t end) {
+        size_t out = offsets[chunk];
+        for (size_t i = begin; i < end; ++i) {
+            if (!predicate(storage->P3data[i])) {
+                compacted[out++] = storage->P3data[i];
+            }
+        }
+    });
+
+    replaceData(compacted, from);
+    return true;
+}
+
+// Empty storage allocating from the given memory resource
+TimeSeriesTransformations::Storage::Storage(std::pmr::memory_resource* resource)
+    : P3data(resource),
+      features(StreamingFeatures::defaultAlpha, false, resource),
+      blockIndex(resource),
+      incrementTree(resource),
+      priceSketch(TDigest::defaultCompression, resource),
+      incrementSketch(TDigest::defaultCompression, resource),
+      featureHistory(StreamingFeatures::defaultAlpha, true, resource) {}
+
+// Copy of other's storage, allocating from the given memory resource (assignment keeps the
+// resource each member was constructed with)
+TimeSeriesTransformations::Storage::Storage(const Storage& other, std::pmr::memory_resource* resource)
+    : Storage(resource) {
+    P3data = other.P3data;
+    observations = other.observations;
+    features = other.features;
+
+    std::lock_guard<std::mutex> lock(other.summaryMutex);
+    blockIndexBuilt = other.blockIndexBuilt;
+    if (blockIndexBuilt) {
+        blockIndex = other.blockIndex;
+    }
+    incrementTreeBuilt = other.incrementTreeBuilt;
+    if (incrementTreeBuilt) {
+        incrementTree = other.incrementTree;
+    }
+    priceSketchCurrent = other.priceSketchCurrent;
+    if (priceSketchCurrent) {
+        priceSketch = other.priceSketch;
+    }
+    incrementSketchCurrent = other.incrementSketchCurrent;
+    if (incrementSketchCurrent) {
+        incrementSketch = other.incrementSketch;
+    }
+    featureHistoryCurrent = other.featureHistoryCurrent;
+    featureHistory = other.featureHistory; // Empty unless current
+}
+
+// Allocate empty storage, together with its control block, from the given memory resource
+std::shared_ptr<TimeSeriesTransformations::Storage> TimeSeriesTransformations::makeStorage(
+    std::pmr::memory_resource* resource) {
+    return std::allocate_shared<Storage>(std::pmr::polymorphic_allocator<Storage>(resource), resource);
+}
+
+// t's storage if it allocates from the given memory resource, otherwise a copy allocated from it
+std::shared_ptr<TimeSeriesTransformations::Storage> TimeSeriesTransformations::shareStorage(
+    const TimeSeriesTransformations& t, std::pmr::memory_resource* resource) {
+    if (t.getResource() == resource) {
+        return t.storage;
+    }
+    return std::allocate_shared<Storage>(std::pmr::polymorphic_allocator<Storage>(resource), *t.storage, resource);
+}
+
+// Give this series its own copy of the data before changing it, if other series share it
+void TimeSeriesTransformations::detach() {
+    if (storage.use_count() > 1) {
+        std::pmr::memory_resource* resource = getResource();
+        storage = std::allocate_shared<Storage>(std::pmr::polymorphic_allocator<Storage>(resource), *storage, resource);
+    }
+}
+
+// Replace the data with entries (from this series' resource) equal to it before entry `from`. Shared
+// storage is not copied only to be overwritten: fresh storage takes the entries, keeping just the
+// summaries of the unchanged prefix
+void TimeSeriesTransformations::replaceData(std::pmr::vector<std::pair<int, double>>& data, size_t from) {
+    if (storage.use_count() > 1) {
+        std::shared_ptr<Storage> fresh = makeStorage(getResource());
+        fresh->observations = storage->observations;
+        {
+            std::lock_guard<std::mutex> lock(storage->summaryMutex);
+            fresh->blockIndexBuilt = storage->blockIndexBuilt;
+            if (fresh->blockIndexBuilt) {
+                fresh->blockIndex = storage->blockIndex;
+            }
+            fresh->incrementTreeBuilt = storage->incrementTreeBuilt;
+            if (fresh->incrementTreeBuilt) {
+                fresh->incrementTree = storage->incrementTree;
+            }
+        }
+        // Keep the feature settings, which the fresh storage would otherwise reset to the defaults
+        double alpha = featureSmoothing();
+        fresh->features = StreamingFeatures(alpha);
+        fresh->featureHistory = StreamingFeatures(alpha, true);
+        storage = std::move(fresh);
+    }
+    storage->P3data.swap(data);
+    dataChanged(from);
+}
+
+// Update the observation count and summaries after the data changed at or after entry `from`
+void TimeSeriesTransformations::dataChanged(size_t from) {
+    size_t previous = storage->observations;
+    storage->observations = storage->P3data.size();
+    if (storage->blockIndexBuilt) {
+        storage->blockIndex.update(storage->P3data.data(), storage->P3data.size(), from);
+    }
+    if (storage->incrementTreeBuilt) {
+        storage->incrementTree.update(storage->P3data.data(), storage->P3data.size(), from);
+    }
+    updateStreamingSummaries(from, previous);
+}
+
+// Keep the quantile sketches and streaming features current. Loading into an empty series builds
+// them in one pass, and an appended entry is added to them. Any other change recomputes the latest
+// features in one pass. Values cannot be taken back out of the sketches or the feature history, so
+// a change that removes any leaves them to be rebuilt by the next query; a single insert only
+// removes an increment, so the price sketch takes it directly
+void TimeSeriesTransformations::updateStreamingSummaries(size_t from, size_t previous) {
+    const auto& data = storage->P3data;
+    if (previous == 0) {
+        storage->priceSketch.clear();
+        storage->incrementSketch.clear();
+        storage->features.clear();
+        for (size_t i = 0; i < data.size(); ++i) {
+            storage->priceSketch.add(data[i].second);
+            if (i > 0) {
+                storage->incrementSketch.add(data[i].second - data[i - 1].second);
+            }
+            storage->features.add(data[i].second);
+        }
+        storage->priceSketchCurrent = true;
+        storage->incrementSketchCurrent = true;
+        storage->featureHistoryCurrent = false;
+        storage->featureHistory.clear();
+        return;
+    }
+
+    bool inserted = previous + 1 == data.size();
+    if (inserted && storage->priceSketchCurrent) {
+        storage->priceSketch.add(data[from].second);
+    }
+    if (inserted && from == previous) {
+        if (storage->incrementSketchCurrent) {
+            storage->incrementSketch.add(data[from].second - data[from - 1].second);
+        }
+        storage->features.add(data[from].second);
+        if (storage->featureHistoryCurrent) {
+            storage->featureHistory.add(data[from].second);
+        }
+        return;
+    }
+
+    if (!inserted) {
+        storage->priceSketchCurrent = false;
+        storage->priceSketch.clear();
+    }
+    storage->incrementSketchCurrent = false;
+    storage->incrementSketch.clear();
+    storage->featureHistoryCurrent = false;
+    storage->featureHistory.clear();
+
+    storage->features.clear();
+    for (const auto& entry : data) {
+        storage->features.add(entry.second);
+    }
+}
+
+// Get the block summaries, building them on first use
+const BlockSummaryIndex& TimeSeriesTransformations::summaryIndex() const {
+    std::lock_guard<std::mutex> lock(storage->summaryMutex);
+    if (!storage->blockIndexBuilt) {
+        storage->blockIndex.update(storage->P3data.data(), storage->P3data.size(), 0);
+        storage->blockIndexBuilt = true;
+    }
+    return storage->blockIndex;
+}
+
+// Get the range-max tree over the increments, building it on first use
+const IncrementMaxTree& TimeSeriesTransformations::incrementMaxTree() const {
+    std::lock_guard<std::mutex> lock(storage->summaryMutex);
+    if (!storage->incrementTreeBuilt) {
+        storage->incrementTree.update(storage->P3data.data(), storage->P3data.size(), 0);
+        storage->incrementTreeBuilt = true;
+    }
+    return storage->incrementTree;
+}
+
+// Rebuild the quantile sketches if a change left them stale
+void TimeSeriesTransformations::refreshSketches() const {
+    std::lock_guard<std::mutex> lock(storage->summaryMutex);
+    const auto& data = storage->P3data;
+    if (!storage->priceSketchCurrent) {
+        for (const auto& entry : data) {
+            storage->priceSketch.add(entry.second);
+        }
+        storage->priceSketchCurrent = true;
+    }
+    if (!storage->incrementSketchCurrent) {
+        for (size_t i = 1; i < data.size(); ++i) {
+            storage->incrementSketch.add(data[i].second - data[i - 1].second);
+        }
+        storage->incrementSketchCurrent = true;
+    }
+}
+
+// Build the feature history if not already current
+void TimeSeriesTransformations::refreshFeatureHistory() const {
+    std::lock_guard<std::mutex> lock(storage->summaryMutex);
+    if (storage->featureHistoryCurrent) {
+        return;
+    }
 
-    observations = P3data.size();
-    return (initialSize != observations);
+    storage->featureHistory.clear();
+    for (const auto& entry : storage->P3data) {
+        storage->featureHistory.add(entry.second);
+    }
+    storage->featureHistoryCurrent = true;
 }
 
 // Print share prices on a specific date
@@ -430,7 +1213,7 @@ std::string TimeSeriesTransformations::printSharePricesOnDate(std::string date)
     time_t unix = truncData(date);
     std::string sharePrices;
 
-    for (const auto& entry : P3data) {
+    for (const auto& entry : storage->P3data) {
         // Truncate the entry's timestamp to the start of the day
         time_t entryUnix = truncUnix(static_cast<time_t>(entry.first));
 
@@ -450,9 +1233,9 @@ std::string TimeSeriesTransformations::printIncrementsOnDate(std::string date) c
     time_t unix = truncData(date);
     std::string increments;
 
-    for (size_t i = 0; i < P3data.size() - 1; ++i) {
-        if (truncUnix(static_cast<time_t>(P3data[i].first)) == unix) {
-            increments += std::to_string(P3data[i + 1].second - P3data[i].second) + '\n';
+    for (size_t i = 0; i < storage->P3data.size() - 1; ++i) {
+        if (truncUnix(static_cast<time_t>(storage->P3data[i].first)) == unix) {
+            increments += std::to_string(storage->P3data[i + 1].second - storage->P3data[i].second) + '\n';
         }
     }
 
@@ -462,58 +1245,220 @@ std::string TimeSeriesTransformations::printIncrementsOnDate(std::string date) c
 
 // Find the greatest increment in the time series
 bool TimeSeriesTransformations::findGreatestIncrements(std::string* date, double* price_increment) const {
-    if (P3data.empty()) {
-        *price_increment = std::numeric_limits<double>::quiet_NaN();
-        return false;
-    }
+    return view().findGreatestIncrements(date, price_increment);
+}
 
-    std::vector<double> increments = computeIncrements();
-    auto maxIncrement = std::max_element(increments.begin(), increments.end());
+// Get the price at a specific date
+bool TimeSeriesTransformations::getPriceAtDate(const std::string date, double* value) const {
+    int unix = static_cast<int>(dateTimeToUnix(date));
+    size_t i = lowerBound(unix, 0, storage->P3data.size());
 
-    if (maxIncrement != increments.end()) {
-        size_t index = std::distance(increments.begin(), maxIncrement);
-        *date = unixToDateTime(static_cast<time_t>(P3data[index].first));
-        *price_increment = *maxIncrement;
+    if (i != storage->P3data.size() && storage->P3data[i].first == unix) {
+        *value = storage->P3data[i].second;
         return true;
     }
 
+    *value = std::numeric_limits<double>::quiet_NaN();
     return false;
 }
 
-// Get the price at a specific date
-bool TimeSeriesTransformations::getPriceAtDate(const std::string date, double* value) const {
-    time_t unix = dateTimeToUnix(date);
-    auto it = std::find_if(P3data.begin(), P3data.end(),
-        [unix](const std::pair<int, double>& entry) {
-            return entry.first == static_cast<int>(unix);
-        });
+// Sample the prices on a regular time grid, advancing through the data alongside the grid
+bool TimeSeriesTransformations::reindex(std::string start, int step, FillPolicy fill,
+    std::vector<double>* output) const {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    try {
+        if (step <= 0) {
+            throw std::invalid_argument("Reindex step must be positive.");
+        }
+        if (storage->P3data.empty()) {
+            throw std::runtime_error("Empty vector!!");
+        }
+
+        const auto& data = storage->P3data;
+        long long time = static_cast<long long>(dateTimeToUnix(start));
+        size_t next = 0; // First entry after the current grid point
+
+        for (double& value : *output) {
+            while (next < data.size() && data[next].first <= time) {
+                ++next;
+            }
 
-    if (it != P3data.end()) {
-        *value = it->second;
+            if (next == 0) {
+                value = nan; // Before the first entry
+            } else if (data[next - 1].first == time || fill == FillPolicy::ForwardFill) {
+                value = data[next - 1].second;
+            } else if (fill == FillPolicy::Linear && next < data.size()) {
+                const auto& before = data[next - 1];
+                const auto& after = data[next];
+                value = before.second + (after.second - before.second) * (time - before.first) /
+                    (after.first - before.first);
+            } else {
+                value = nan;
+            }
+            time += step;
+        }
         return true;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        std::fill(output->begin(), output->end(), nan);
+        return false;
     }
+}
 
-    *value = std::numeric_limits<double>::quiet_NaN();
-    return false;
+// Find the intervals between consecutive entries longer than maxInterval seconds
+std::vector<TimeSeriesTransformations::Gap> TimeSeriesTransformations::findGaps(int maxInterval) const {
+    const auto& data = storage->P3data;
+    std::vector<Gap> gaps;
+
+    for (size_t i = 1; i < data.size(); ++i) {
+        int duration = data[i].first - data[i - 1].first;
+        if (duration > maxInterval) {
+            gaps.push_back({ data[i - 1].first, data[i].first, duration });
+        }
+    }
+    return gaps;
+}
+
+// View the whole series
+SeriesView TimeSeriesTransformations::view() const {
+    return SeriesView(*this, 0, storage->P3data.size());
+}
+
+// View the entries between two dates (inclusive)
+SeriesView TimeSeriesTransformations::view(std::string from, std::string to) const {
+    return view().view(from, to);
+}
+
+// View the entries on a specific date
+SeriesView TimeSeriesTransformations::viewOnDate(std::string date) const {
+    int dayStart = truncData(date);
+    size_t begin = lowerBound(dayStart, 0, storage->P3data.size());
+    size_t end = lowerBound(dayStart + 86400, begin, storage->P3data.size());
+    return SeriesView(*this, begin, end);
+}
+
+// Index of the first entry in [first, last) at or after a time
+size_t TimeSeriesTransformations::lowerBound(int time, size_t first, size_t last) const {
+    auto it = std::lower_bound(storage->P3data.begin() + first, storage->P3data.begin() + last, time,
+        [](const std::pair<int, double>& entry, int t) {
+            return entry.first < t;
+        });
+    return static_cast<size_t>(it - storage->P3data.begin());
+}
+
+// Index of the first entry in [first, last) after a time
+size_t TimeSeriesTransformations::upperBound(int time, size_t first, size_t last) const {
+    auto it = std::upper_bound(storage->P3data.begin() + first, storage->P3data.begin() + last, time,
+        [](int t, const std::pair<int, double>& entry) {
+            return t < entry.first;
+        });
+    return static_cast<size_t>(it - storage->P3data.begin());
 }
 
 // Save the time series data to a CSV file
 void TimeSeriesTransformations::saveData(std::string filename) const {
+    saveData(filename, 6);
+}
+
+// Save the time series data to a CSV file, formatting prices with the given number of
+// significant digits and, optionally, timestamps as "YYYY-MM-DD HH:MM:SS"
+void TimeSeriesTransformations::saveData(std::string filename, int precision, bool isoTimestamps) const {
+    writeCsv(filename, precision, isoTimestamps, nullptr, nullptr);
+}
+
+// Save the time series data on a background thread; progress is reported in rows written
+std::future<void> TimeSeriesTransformations::saveDataAsync(std::string filename, ProgressCallback progress,
+    CancellationToken cancel, int precision, bool isoTimestamps) const {
+    // Work on a snapshot so the caller may keep modifying (or destroy) this object
+    auto snapshot = std::make_shared<const TimeSeriesTransformations>(*this);
+
+    return std::async(std::launch::async, [snapshot, filename, progress, cancel, precision, isoTimestamps]() {
+        snapshot->writeCsv(filename, precision, isoTimestamps, progress, cancel);
+    });
+}
+
+// Write the CSV in batches of rows, formatting each batch in parallel and writing it in one go
+void TimeSeriesTransformations::writeCsv(const std::string& filename, int precision, bool isoTimestamps,
+    const ProgressCallback& progress, const CancellationToken& cancel) const {
+    if (precision < 1 || precision > std::numeric_limits<double>::max_digits10) {
+        throw std::invalid_argument("Invalid precision: " + std::to_string(precision));
+    }
+
     std::ofstream newCsv(filename + ".csv");
 
-    if (newCsv.is_open()) {
-        newCsv << "Unix-TIME SERIES DATA: " << _name << std::endl;
+    if (!newCsv.is_open()) {
+        throw std::runtime_error("Unable to save data to file: " + filename + ".csv");
+    }
+
+    newCsv << "Unix-TIME SERIES DATA: " << _name << '\n';
 
-        for (const auto& entry : P3data) {
-            newCsv << entry.first << ',' << entry.second << std::endl;
+    std::vector<std::string> buffers;
+    for (size_t batchBegin = 0; batchBegin < storage->P3data.size(); batchBegin += rowsPerWriteBatch) {
+        if (cancel && *cancel) {
+            newCsv.close();
+            std::remove((filename + ".csv").c_str());
+            throw std::runtime_error("Saving cancelled: " + filename + ".csv");
         }
 
-        newCsv.close();
-    } else {
+        size_t batchSize = std::min(rowsPerWriteBatch, storage->P3data.size() - batchBegin);
+
+        // Format contiguous chunks of rows into their own buffers on separate threads
+        size_t workers = ParallelChunks::workerCount(batchSize, rowsPerFormatChunk);
+        buffers.resize(workers);
+
+        ParallelChunks::run(batchSize, workers, [&](size_t chunk, size_t begin, size_t end) {
+            formatRows(batchBegin + begin, batchBegin + end, precision, isoTimestamps, buffers[chunk]);
+        });
+
+        // Write each buffer with a single large write, in order
+        for (size_t chunk = 0; chunk < workers; ++chunk) {
+            newCsv.write(buffers[chunk].data(), static_cast<std::streamsize>(buffers[chunk].size()));
+        }
+
+        if (progress) {
+            progress(batchBegin + batchSize, storage->P3data.size());
+        }
+    }
+
+    newCsv.close();
+    if (newCsv.fail()) {
         throw std::runtime_error("Unable to save data to file: " + filename + ".csv");
     }
 }
 
+// Format rows [begin, end) as "time,price" lines into out
+void TimeSeriesTransformations::formatRows(size_t begin, size_t end, int precision, bool isoTimestamps,
+    std::string& out) const {
+    // Longest line: a 19 character date or 11 character int, a comma, a double and a newline
+    const size_t maxLineLength = 19 + 1 + 32 + 1;
+    out.resize((end - begin) * maxLineLength);
+
+    char* pos = out.data();
+    char* last = out.data() + out.size();
+
+    for (size_t i = begin; i < end; ++i) {
+        if (isoTimestamps) {
+            std::string dateTime = unixToDateTime(static_cast<time_t>(storage->P3data[i].first));
+            pos = std::copy(dateTime.begin(), dateTime.end(), pos);
+        } else {
+            pos = std::to_chars(pos, last, storage->P3data[i].first).ptr;
+        }
+
+        *pos++ = getSeparator();
+        pos = std::to_chars(pos, last, storage->P3data[i].second, std::chars_format::general, precision).ptr;
+        *pos++ = '\n';
+    }
+
+    out.resize(pos - out.data());
+}
+
+// Shortest text that reads back as the same double
+std::string TimeSeriesTransformations::formatDouble(double value) {
+    char buffer[32];
+    return std::string(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+}
+
 // Get the separator used in CSV files
 char TimeSeriesTransformations::getSeparator() const {
     return ',';
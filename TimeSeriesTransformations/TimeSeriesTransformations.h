@@ -1,32 +1,118 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
 #include <ctime>
 #include <chrono>
 #include <time.h>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include "SeriesView.h"
+#include "BlockSummaryIndex.h"
+#include "IncrementMaxTree.h"
+#include "TDigest.h"
+#include "Histogram.h"
+#include "StreamingFeatures.h"
 
 class TimeSeriesTransformations {
 public:
+    // Called with (done, total) as asynchronous loads and saves make progress
+    using ProgressCallback = std::function<void(size_t, size_t)>;
+    // Set to true to cancel an asynchronous load or save
+    using CancellationToken = std::shared_ptr<std::atomic<bool>>;
+
+    // How bulk operations run. The parallel policies split the data into contiguous chunks, one per
+    // worker thread; ParallelUnsequenced additionally allows vectorization within a chunk, which the
+    // chunk loops already permit, so it currently behaves like Parallel. Filters give exactly the
+    // sequential result. Parallel statistics add per-chunk sums in chunk order, so they may differ from
+    // the sequential result by rounding: for n values the relative difference of a sum is at most about
+    // n * DBL_EPSILON * sum(|x|) / |sum(x)|, i.e. n * DBL_EPSILON for positive prices.
+    enum class ExecutionPolicy { Sequential, Parallel, ParallelUnsequenced };
+
+    // Timestamps that differ between two series, as found by diff()
+    struct Diff {
+        std::vector<int> inserted; // Only in the other series
+        std::vector<int> removed; // Only in this series
+        std::vector<int> changed; // In both, with different prices
+
+        bool empty() const;
+    };
+
+    // How reindex() fills grid points without an entry at exactly that time
+    enum class FillPolicy {
+        ForwardFill, // Price of the last entry before the point
+        Linear, // Linear interpolation between the entries either side of the point
+        NaN // Not filled
+    };
+
+    // Interval between consecutive entries longer than allowed, as found by findGaps()
+    struct Gap {
+        int from; // Time of the entry before the gap
+        int to; // Time of the entry after the gap
+        int duration; // to - from, in seconds
+    };
+
     // Constructors
     TimeSeriesTransformations();
     explicit TimeSeriesTransformations(const std::string& filenameandpath);
     TimeSeriesTransformations(const std::vector<int>& time, const std::vector<double>& price, std::string name = "");
 
-    // Copy constructor
+    // Constructors allocating from a caller-supplied memory resource (e.g. a monotonic arena or a pool),
+    // which must outlive the object
+    explicit TimeSeriesTransformations(std::pmr::memory_resource* resource);
+    TimeSeriesTransformations(const std::vector<int>& time, const std::vector<double>& price, std::string_view name,
+        std::pmr::memory_resource* resource);
+
+    // Copy constructors; a copy allocating from the same resource shares the data until either
+    // series changes it
     TimeSeriesTransformations(const TimeSeriesTransformations& t);
+    TimeSeriesTransformations(const TimeSeriesTransformations& t, std::pmr::memory_resource* resource);
 
     // Assignment operator
     TimeSeriesTransformations& operator=(const TimeSeriesTransformations& t);
 
-    // Equality operator
+    // Equality operator; O(1) when the content hashes differ
     bool operator==(const TimeSeriesTransformations& t) const;
 
+    // Content hash of the entries (not the name), computed on first use and then kept up to date as the
+    // series changes
+    uint64_t hash() const;
+    // Differences from this series to another, in one merge pass over both
+    Diff diff(const TimeSeriesTransformations& other) const;
+
     // Statistical functions
     bool mean(double* meanValue) const;
     bool standardDeviation(double* standardDeviationValue) const;
     bool computeIncrementMean(double* meanValue) const;
     bool computeIncrementStandardDeviation(double* standardDeviationValue) const;
+    bool mean(ExecutionPolicy policy, double* meanValue) const;
+    bool standardDeviation(ExecutionPolicy policy, double* standardDeviationValue) const;
+    bool computeIncrementMean(ExecutionPolicy policy, double* meanValue) const;
+    bool computeIncrementStandardDeviation(ExecutionPolicy policy, double* standardDeviationValue) const;
+
+    // Distribution summaries; the quantiles come from sketches built during ingestion and extended on
+    // append, and rebuilt by the first query after a removal
+    bool priceQuantile(double q, double* value) const;
+    bool incrementQuantile(double q, double* value) const;
+    bool valueAtRisk(double confidence, double* value) const;
+    const TDigest& getPriceSketch() const;
+    const TDigest& getIncrementSketch() const;
+    Histogram priceHistogram(double lower, double upper, size_t bins) const;
+    Histogram incrementHistogram(double lower, double upper, size_t bins) const;
+
+    // Returns, EWMA mean and volatility and z-scores. getFeatures() has the features of the latest price,
+    // computed during ingestion and updated in O(1) per appended price, so reading them never
+    // recomputes anything. getFeatureHistory() has one value per tick; it is built on first request,
+    // extended on append and dropped by any other change until it is next requested
+    const StreamingFeatures& getFeatures() const;
+    const StreamingFeatures& getFeatureHistory() const;
+    double featureSmoothing() const;
+    void setFeatureSmoothing(double alpha);
 
     // Data manipulation functions
     void addASharePrice(std::string datetime, double price);
@@ -35,6 +121,11 @@ public:
     bool removePricesLowerThan(double price);
     bool removePricesBefore(std::string date);
     bool removePricesAfter(std::string date);
+    bool removeEntryAtTime(ExecutionPolicy policy, std::string time);
+    bool removePricesGreaterThan(ExecutionPolicy policy, double price);
+    bool removePricesLowerThan(ExecutionPolicy policy, double price);
+    bool removePricesBefore(ExecutionPolicy policy, std::string date);
+    bool removePricesAfter(ExecutionPolicy policy, std::string date);
 
     // Print functions
     std::string printSharePricesOnDate(std::string date) const;
@@ -43,11 +134,30 @@ public:
     // Utility functions
     bool findGreatestIncrements(std::string* date, double* price_increment) const;
     bool getPriceAtDate(const std::string date, double* value) const;
+    // Sample the prices on the regular grid start, start + step, ... into the preallocated output, one
+    // point per element, in a single pass; points before the first entry or that cannot be filled are NaN
+    bool reindex(std::string start, int step, FillPolicy fill, std::vector<double>* output) const;
+    std::vector<Gap> findGaps(int maxInterval) const;
     void saveData(std::string filename) const;
+    void saveData(std::string filename, int precision, bool isoTimestamps = false) const;
+
+    // Asynchronous I/O
+    static std::future<TimeSeriesTransformations> loadAsync(const std::string& filenameandpath,
+        ProgressCallback progress = nullptr, CancellationToken cancel = nullptr);
+    std::future<void> saveDataAsync(std::string filename, ProgressCallback progress = nullptr,
+        CancellationToken cancel = nullptr, int precision = 6, bool isoTimestamps = false) const;
+
+    // Zero-copy views onto the whole series, a time range (inclusive) or a single day; see SeriesView
+    // for how their statistics may differ by rounding from those of a filtered copy
+    SeriesView view() const;
+    SeriesView view(std::string from, std::string to) const;
+    SeriesView viewOnDate(std::string date) const;
 
     // Getters
     int count() const;
     std::string getName() const;
+    std::pmr::memory_resource* getResource() const;
+    bool sharesDataWith(const TimeSeriesTransformations& t) const;
     char getSeparator() const;
     std::vector<double> getPrice() const;
     std::vector<int> getTime() const;
@@ -59,20 +169,91 @@ public:
     // Static helper functions
     static int truncData(std::string& date);
     static int truncUnix(const time_t& unix);
+    static std::string formatDouble(double value);
     
     // Public method to access increments
     std::vector<double> getIncrements() const; 
+    std::vector<double> getIncrements(ExecutionPolicy policy) const;
     
 private:
+    friend class SeriesView;
+    friend class DiskBackedTimeSeries;
+
     const int decimalPlaces = 5; // Number of decimal places for rounding
-    std::vector<std::pair<int, double>> P3data{}; // Stores time and price data
-    std::string _name{}; // Name of the time series
-    size_t observations{}; // Number of observations
+    static constexpr size_t rowsPerFormatChunk = 65536; // Minimum rows formatted per thread by saveData
+    static constexpr size_t rowsPerWriteBatch = 1 << 20; // Rows formatted and written per batch by saveData
+    static constexpr size_t readBlockSize = 1 << 20; // Bytes per read by loadAsync
+    static constexpr size_t parallelGrainSize = 1 << 16; // Minimum entries per thread for parallel policies
+
+    // The data and everything derived from it, all allocated from the series' memory resource. Copies
+    // of a series share one Storage; a series makes its own copy (detach) before its first change, so
+    // copying is O(1)
+    struct Storage {
+        explicit Storage(std::pmr::memory_resource* resource);
+        Storage(const Storage& other, std::pmr::memory_resource* resource);
+
+        std::pmr::vector<std::pair<int, double>> P3data; // Stores time and price data
+        size_t observations{}; // Number of observations
+        StreamingFeatures features; // Returns and weighted statistics of the latest entry, always current
+
+        // summaryMutex guards the builds of the summaries below, since const queries on shared
+        // storage may race to do them
+        mutable std::mutex summaryMutex;
+
+        // Built on the first query that needs them, then updated with every change
+        mutable bool blockIndexBuilt = false;
+        mutable BlockSummaryIndex blockIndex; // Per-block summaries of the data for range aggregates
+        mutable bool incrementTreeBuilt = false;
+        mutable IncrementMaxTree incrementTree; // Range-max structure over the increments
+
+        // Quantile sketches, built during ingestion and extended by appends (and the price sketch by
+        // any insert). Values cannot be taken back out, so other changes leave them to be rebuilt by
+        // the next query
+        mutable bool priceSketchCurrent = true;
+        mutable TDigest priceSketch; // Quantile sketch of the prices
+        mutable bool incrementSketchCurrent = true;
+        mutable TDigest incrementSketch; // Quantile sketch of the increments
+
+        // Built on first request and extended by appends; other changes leave it to be rebuilt
+        mutable bool featureHistoryCurrent = false;
+        mutable StreamingFeatures featureHistory; // Returns and weighted statistics of every entry
+    };
+
+    std::shared_ptr<Storage> storage; // Never null
+    std::pmr::string _name{}; // Name of the time series
 
     // Private helper functions
     static double getMean(const std::vector<double>& vector);
     static double getSD(const std::vector<double>& vector);
     std::vector<double> computeIncrements() const;
+    std::vector<double> computeIncrements(ExecutionPolicy policy) const;
+    size_t workersFor(ExecutionPolicy policy, size_t n) const;
+    template <typename Value>
+    static double parallelMean(size_t n, size_t workers, Value value);
+    template <typename Value>
+    static double parallelSD(size_t n, size_t workers, Value value);
+    template <typename Predicate>
+    bool removeIf(Predicate predicate);
+    template <typename Predicate>
+    bool removeIf(ExecutionPolicy policy, Predicate predicate);
+    static std::shared_ptr<Storage> makeStorage(std::pmr::memory_resource* resource);
+    static std::shared_ptr<Storage> shareStorage(const TimeSeriesTransformations& t,
+        std::pmr::memory_resource* resource);
+    void detach();
+    void replaceData(std::pmr::vector<std::pair<int, double>>& data, size_t from);
+    void dataChanged(size_t from);
+    void updateStreamingSummaries(size_t from, size_t previous);
+    const BlockSummaryIndex& summaryIndex() const;
+    const IncrementMaxTree& incrementMaxTree() const;
+    void refreshSketches() const;
+    void refreshFeatureHistory() const;
+    size_t lowerBound(int time, size_t first, size_t last) const;
+    size_t upperBound(int time, size_t first, size_t last) const;
+    void readCsvHeader(const std::string& header);
+    void appendCsvLine(const std::string& line, const std::string& filenameandpath);
+    void writeCsv(const std::string& filename, int precision, bool isoTimestamps,
+        const ProgressCallback& progress, const CancellationToken& cancel) const;
+    void formatRows(size_t begin, size_t end, int precision, bool isoTimestamps, std::string& out) const;
 };
 
         
\ No newline at end of file
@@ -0,0 +1,377 @@
+#include "BatchJob.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include "ThreadPool.h"
+
+namespace {
+    // Match a file name against a pattern with * (any run of characters) and ? (one character)
+    bool wildcardMatch(const std::string& pattern, const std::string& name) {
+        size_t p = 0, n = 0;
+        size_t starPattern = std::string::npos, starName = 0;
+
+        while (n < name.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+                ++p;
+                ++n;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                starPattern = p++;
+                starName = n;
+            } else if (starPattern != std::string::npos) {
+                p = starPattern + 1;
+                n = ++starName;
+            } else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*') {
+            ++p;
+        }
+        return p == pattern.size();
+    }
+
+    // Quote a CSV field if it contains a separator, quote or line break, doubling any quotes in it
+    std::string csvField(const std::string& text) {
+        if (text.find_first_of(",\"\r\n") == std::string::npos) {
+            return text;
+        }
+
+        std::string quoted = "\"";
+        for (char c : text) {
+            quoted += c;
+            if (c == '"') {
+                quoted += c;
+            }
+        }
+        return quoted + '"';
+    }
+
+    double parseNumber(const std::string& text, const std::string& spec) {
+        try {
+            size_t used;
+            double value = std::stod(text, &used);
+            if (used == text.size()) {
+                return value;
+            }
+        } catch (const std::exception&) {
+        }
+        throw std::invalid_argument("Invalid number in operation: " + spec);
+    }
+
+    // Parse a whole number of seconds between 1 and INT_MAX
+    int parseSeconds(const std::string& text, const std::string& spec) {
+        if (!text.empty() && text.size() <= 10 && text.find_first_not_of("0123456789") == std::string::npos) {
+            long long value = std::stoll(text);
+            if (value >= 1 && value <= std::numeric_limits<int>::max()) {
+                return static_cast<int>(value);
+            }
+        }
+        throw std::invalid_argument("Invalid number of seconds in operation: " + spec);
+    }
+}
+
+// Parse an operation from "name" or "name=argument"
+Operation Operation::parse(const std::string& spec) {
+    static const std::map<std::string, Kind> kinds = {
+        { "removeAbove", Kind::RemoveAbove }, { "removeBelow", Kind::RemoveBelow },
+        { "removeBefore", Kind::RemoveBefore }, { "removeAfter", Kind::RemoveAfter },
+        { "mean", Kind::Mean }, { "sd", Kind::StandardDeviation },
+        { "incrementMean", Kind::IncrementMean }, { "incrementSd", Kind::IncrementStandardDeviation },
+        { "count", Kind::Count }, { "quantile", Kind::Quantile },
+        { "resample", Kind::Resample }, { "save", Kind::Save }
+    };
+
+    size_t equals = spec.find('=');
+    auto kind = kinds.find(spec.substr(0, equals));
+    if (kind == kinds.end()) {
+        throw std::invalid_argument("Unknown operation: " + spec);
+    }
+
+    Operation operation;
+    operation.kind = kind->second;
+    operation.spec = spec;
+    operation.argument = equals == std::string::npos ? "" : spec.substr(equals + 1);
+
+    switch (operation.kind) {
+    case Kind::RemoveAbove:
+    case Kind::RemoveBelow:
+        operation.number = parseNumber(operation.argument, spec);
+        break;
+    case Kind::Quantile:
+        operation.number = parseNumber(operation.argument, spec);
+        if (!(operation.number >= 0.0 && operation.number <= 1.0)) {
+            throw std::invalid_argument("Quantile must be between 0 and 1: " + spec);
+        }
+        break;
+    case Kind::Resample: {
+        size_t comma = operation.argument.find(',');
+        operation.step = parseSeconds(operation.argument.substr(0, comma), spec);
+        std::string fill = comma == std::string::npos ? "ffill" : operation.argument.substr(comma + 1);
+        if (fill == "ffill") {
+            operation.fill = TimeSeriesTransformations::FillPolicy::ForwardFill;
+        } else if (fill == "linear") {
+            operation.fill = TimeSeriesTransformations::FillPolicy::Linear;
+        } else if (fill == "nan") {
+            operation.fill = TimeSeriesTransformations::FillPolicy::NaN;
+        } else {
+            throw std::invalid_argument("Unknown fill policy in operation: " + spec);
+        }
+        break;
+    }
+    case Kind::RemoveBefore:
+    case Kind::RemoveAfter:
+    case Kind::Save:
+        if (operation.argument.empty()) {
+            throw std::invalid_argument("Missing argument in operation: " + spec);
+        }
+        break;
+    default:
+        break;
+    }
+    return operation;
+}
+
+// Check whether the operation produces a value for the results
+bool Operation::isStatistic() const {
+    switch (kind) {
+    case Kind::Mean:
+    case Kind::StandardDeviation:
+    case Kind::IncrementMean:
+    case Kind::IncrementStandardDeviation:
+    case Kind::Count:
+    case Kind::Quantile:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Constructor
+BatchJob::BatchJob(std::vector<std::string> inputs, std::vector<Operation> operations, size_t threads)
+    : inputs(std::move(inputs)), operations(std::move(operations)), threads(std::max<size_t>(1, threads)) {}
+
+// Process the inputs on the thread pool
+bool BatchJob::run() {
+    auto start = std::chrono::steady_clock::now();
+    results.assign(inputs.size(), FileResult());
+    rejectOutputClashes();
+
+    {
+        // Queued tasks are only indices and each worker loads its input when it starts it, so at most
+        // one series per thread is in memory
+        ThreadPool pool(std::min(threads, std::max<size_t>(1, inputs.size())));
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (results[i].error.empty()) {
+                pool.submit([this, i]() { process(i); });
+            }
+        }
+        pool.wait();
+    }
+
+    wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return std::none_of(results.begin(), results.end(), [](const FileResult& r) { return !r.error.empty(); });
+}
+
+// Write one CSV row per input
+void BatchJob::writeResults(std::ostream& out) const {
+    out << "file,name,count";
+    for (const auto& operation : operations) {
+        if (operation.isStatistic()) {
+            out << ',' << csvField(operation.spec);
+        }
+    }
+    out << ",error\n";
+
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        const FileResult& result = results[i];
+        out << csvField(inputs[i]) << ',' << csvField(result.name) << ',' << result.count;
+        for (double value : result.statistics) {
+            out << ',' << value;
+        }
+        // Leave the statistics of a failed input empty
+        for (const auto& operation : operations) {
+            if (operation.isStatistic() && !result.error.empty()) {
+                out << ',';
+            }
+        }
+        out << ',' << csvField(result.error) << '\n';
+    }
+}
+
+// Print the time spent in each stage
+void BatchJob::printTimings(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(timingMutex);
+
+    out << std::fixed << std::setprecision(3);
+    out << "Stage timings (seconds, summed over " << inputs.size() << " inputs on " << threads << " threads):\n";
+    for (const auto& stage : stageOrder) {
+        const StageTiming& timing = timings.at(stage);
+        out << "  " << std::left << std::setw(32) << stage << std::right << std::setw(10) << timing.seconds
+            << "  (" << timing.runs << " runs)\n";
+    }
+    out << "  " << std::left << std::setw(32) << "wall clock" << std::right << std::setw(10) << wallSeconds << '\n';
+    out.unsetf(std::ios::floatfield);
+}
+
+// Expand the wildcards in the last component of a path
+std::vector<std::string> BatchJob::expandGlob(const std::string& pattern) {
+    namespace fs = std::filesystem;
+    fs::path path(pattern);
+    std::string namePattern = path.filename().string();
+
+    if (namePattern.find_first_of("*?") == std::string::npos) {
+        return { pattern };
+    }
+
+    fs::path directory = path.has_parent_path() ? path.parent_path() : fs::path(".");
+    std::vector<std::string> matches;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        if (entry.is_regular_file(error) && wildcardMatch(namePattern, entry.path().filename().string())) {
+            matches.push_back((path.has_parent_path() ? entry.path() : entry.path().filename()).string());
+        }
+    }
+
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+// Fail, before processing anything, the inputs that a save operation would write to the same file
+void BatchJob::rejectOutputClashes() {
+    bool saves = std::any_of(operations.begin(), operations.end(), [](const Operation& operation) {
+        return operation.kind == Operation::Kind::Save;
+    });
+    if (!saves) {
+        return;
+    }
+
+    std::map<std::string, std::vector<size_t>> byStem;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        byStem[std::filesystem::path(inputs[i]).stem().string()].push_back(i);
+    }
+    for (const auto& stem : byStem) {
+        if (stem.second.size() > 1) {
+            for (size_t i : stem.second) {
+                results[i].error = "Another input would also be saved as " + stem.first + ".csv";
+            }
+        }
+    }
+}
+
+// Load one input and apply every operation to it
+void BatchJob::process(size_t input) {
+    FileResult& result = results[input];
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        TimeSeriesTransformations ts(inputs[input]);
+        recordTiming("load", std::chrono::steady_clock::now() - start);
+        if (ts.count() == 0) {
+            throw std::runtime_error("No observations in file: " + inputs[input]);
+        }
+
+        for (const auto& operation : operations) {
+            start = std::chrono::steady_clock::now();
+            apply(operation, input, ts, result);
+            recordTiming(operation.spec, std::chrono::steady_clock::now() - start);
+        }
+
+        result.name = ts.getName();
+        result.count = ts.count();
+    } catch (const std::exception& e) {
+        result.statistics.clear();
+        result.error = e.what();
+    }
+}
+
+// Apply one operation to a series
+void BatchJob::apply(const Operation& operation, size_t input, TimeSeriesTransformations& ts,
+    FileResult& result) const {
+    double value = std::numeric_limits<double>::quiet_NaN();
+
+    switch (operation.kind) {
+    case Operation::Kind::RemoveAbove:
+        ts.removePricesGreaterThan(operation.number);
+        return;
+    case Operation::Kind::RemoveBelow:
+        ts.removePricesLowerThan(operation.number);
+        return;
+    case Operation::Kind::RemoveBefore:
+        ts.removePricesBefore(operation.argument);
+        return;
+    case Operation::Kind::RemoveAfter:
+        ts.removePricesAfter(operation.argument);
+        return;
+    case Operation::Kind::Mean:
+        ts.mean(&value);
+        break;
+    case Operation::Kind::StandardDeviation:
+        ts.standardDeviation(&value);
+        break;
+    case Operation::Kind::IncrementMean:
+        ts.computeIncrementMean(&value);
+        break;
+    case Operation::Kind::IncrementStandardDeviation:
+        ts.computeIncrementStandardDeviation(&value);
+        break;
+    case Operation::Kind::Count:
+        value = ts.count();
+        break;
+    case Operation::Kind::Quantile:
+        ts.priceQuantile(operation.number, &value);
+        break;
+    case Operation::Kind::Resample: {
+        std::vector<int> time = ts.getTime();
+        if (time.empty()) {
+            return;
+        }
+
+        // Sample from the first entry to the last, keeping the grid points that could be filled. The
+        // grid is sized by the time span, so it is capped to keep memory bounded per worker
+        int step = operation.step;
+        size_t points = static_cast<size_t>(static_cast<long long>(time.back()) - time.front()) / step + 1;
+        size_t limit = std::max(maxResamplePoints, time.size());
+        if (points > limit) {
+            throw std::runtime_error("Resample grid of " + std::to_string(points) + " points exceeds the limit of "
+                + std::to_string(limit) + ": " + operation.spec);
+        }
+        std::vector<double> grid(points);
+        ts.reindex(TimeSeriesTransformations::unixToDateTime(time.front()), step, operation.fill, &grid);
+
+        std::vector<int> sampledTime;
+        std::vector<double> sampledPrice;
+        for (size_t i = 0; i < grid.size(); ++i) {
+            if (!std::isnan(grid[i])) {
+                sampledTime.push_back(time.front() + static_cast<int>(i) * step);
+                sampledPrice.push_back(grid[i]);
+            }
+        }
+        ts = TimeSeriesTransformations(sampledTime, sampledPrice, ts.getName());
+        return;
+    }
+    case Operation::Kind::Save: {
+        std::filesystem::create_directories(operation.argument);
+        std::filesystem::path stem = std::filesystem::path(inputs[input]).stem();
+        ts.saveData((std::filesystem::path(operation.argument) / stem).string());
+        return;
+    }
+    }
+
+    result.statistics.push_back(value);
+}
+
+// Add the time one input spent in a stage
+void BatchJob::recordTiming(const std::string& stage, std::chrono::steady_clock::duration elapsed) {
+    std::lock_guard<std::mutex> lock(timingMutex);
+
+    auto inserted = timings.emplace(stage, StageTiming());
+    if (inserted.second) {
+        stageOrder.push_back(stage);
+    }
+    inserted.first->second.seconds += std::chrono::duration<double>(elapsed).count();
+    ++inserted.first->second.runs;
+}
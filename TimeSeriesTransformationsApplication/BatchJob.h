@@ -0,0 +1,80 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "TimeSeriesTransformations.h"
+
+// One step applied to every input of a batch job, parsed from "name" or "name=argument":
+//   removeAbove=<price>, removeBelow=<price>, removeBefore=<date>, removeAfter=<date>
+//   mean, sd, incrementMean, incrementSd, count, quantile=<q>
+//   resample=<step seconds>[,ffill|linear|nan]
+//   save=<directory> (inputs whose file names would clash there fail without being processed)
+struct Operation {
+    enum class Kind {
+        RemoveAbove, RemoveBelow, RemoveBefore, RemoveAfter,
+        Mean, StandardDeviation, IncrementMean, IncrementStandardDeviation, Count, Quantile,
+        Resample, Save
+    };
+
+    Kind kind;
+    std::string spec; // The text it was parsed from, used to label results and timings
+    std::string argument;
+    double number = 0.0;
+    int step = 0; // Resample step in seconds
+    TimeSeriesTransformations::FillPolicy fill = TimeSeriesTransformations::FillPolicy::ForwardFill;
+
+    static Operation parse(const std::string& spec);
+    bool isStatistic() const;
+};
+
+// Runs a list of operations over many CSV files on a bounded thread pool. Each worker holds one
+// series at a time, so memory use is bounded by the number of threads, not the number of files.
+class BatchJob {
+public:
+    // Most grid points a resample may produce, unless the input has more entries than this
+    static constexpr size_t maxResamplePoints = size_t(1) << 22;
+
+    BatchJob(std::vector<std::string> inputs, std::vector<Operation> operations, size_t threads);
+
+    // Process every input; returns false if any input failed
+    bool run();
+
+    // One CSV row per input, in input order, with a column per statistic
+    void writeResults(std::ostream& out) const;
+    // Time spent in each stage, summed over the inputs
+    void printTimings(std::ostream& out) const;
+
+    // Files matching a path whose last component may contain * and ? wildcards, sorted by name
+    static std::vector<std::string> expandGlob(const std::string& pattern);
+
+private:
+    struct FileResult {
+        std::string name;
+        int count = 0;
+        std::vector<double> statistics; // One per statistic operation, in order
+        std::string error;
+    };
+
+    struct StageTiming {
+        double seconds = 0.0;
+        size_t runs = 0;
+    };
+
+    std::vector<std::string> inputs;
+    std::vector<Operation> operations;
+    size_t threads;
+    std::vector<FileResult> results;
+    std::vector<std::string> stageOrder; // Stage names in the order they were first timed
+    std::map<std::string, StageTiming> timings;
+    double wallSeconds = 0.0;
+    mutable std::mutex timingMutex;
+
+    void rejectOutputClashes();
+    void process(size_t input);
+    void apply(const Operation& operation, size_t input, TimeSeriesTransformations& ts, FileResult& result) const;
+    void recordTiming(const std::string& stage, std::chrono::steady_clock::duration elapsed);
+};
@@ -1,20 +1,128 @@
+#include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 #include "TimeSeriesTransformations.h"
+#include "BatchJob.h"
 
-int main() {
-    // Example usage of the TimeSeriesTransformations class
-    TimeSeriesTransformations ts("Problem3_DATA.csv");
+namespace {
+    // Parse a positive number of jobs, rejecting signs, trailing text and values that overflow
+    size_t parseJobs(const std::string& text) {
+        if (!text.empty() && text.size() <= 6 && text.find_first_not_of("0123456789") == std::string::npos) {
+            size_t jobs = std::stoul(text);
+            if (jobs > 0) {
+                return jobs;
+            }
+        }
+        throw std::invalid_argument("Invalid number of jobs: " + text);
+    }
+
+    void printUsage() {
+        std::cout <<
+            "Usage: TimeSeriesTransformationsApplication [options] <input>... --op <operation>...\n"
+            "\n"
+            "Applies the operations, in order, to every input CSV file and writes one row of results\n"
+            "per file. Inputs may contain * and ? wildcards in their file name.\n"
+            "\n"
+            "Options:\n"
+            "  --op <operation>   Add an operation (repeatable)\n"
+            "  --jobs <n>         Number of files processed concurrently (default: hardware threads)\n"
+            "  --output <file>    Write the results CSV to a file instead of standard output\n"
+            "  --help             Show this message\n"
+            "\n"
+            "Operations:\n"
+            "  removeAbove=<price>  removeBelow=<price>  removeBefore=<date>  removeAfter=<date>\n"
+            "  mean  sd  incrementMean  incrementSd  count  quantile=<q>\n"
+            "  resample=<step seconds>[,ffill|linear|nan]\n"
+            "  save=<directory>\n"
+            "\n"
+            "Example:\n"
+            "  TimeSeriesTransformationsApplication 'data/*.csv' --op \"removeBefore=2021-04-23 00:00:00\" \\\n"
+            "      --op resample=3600,linear --op mean --op sd --op save=out --jobs 4\n"
+            "\n"
+            "With no arguments, prints the count and mean of Problem3_DATA.csv.\n";
+    }
+
+    // The original example: summarize Problem3_DATA.csv
+    int runExample() {
+        TimeSeriesTransformations ts("Problem3_DATA.csv");
+
+        // Print the number of observations
+        std::cout << "Number of observations: " << ts.count() << std::endl;
+
+        // Calculate and print the mean
+        double meanValue;
+        if (ts.mean(&meanValue)) {
+            std::cout << "Mean price: " << meanValue << std::endl;
+        } else {
+            std::cerr << "Failed to calculate mean." << std::endl;
+        }
+
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        return runExample();
+    }
+
+    std::vector<std::string> inputs;
+    std::vector<Operation> operations;
+    size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    std::string output;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (arg == "--help" || arg == "-h") {
+                printUsage();
+                return 0;
+            } else if (arg == "--op" && hasValue) {
+                operations.push_back(Operation::parse(argv[++i]));
+            } else if (arg == "--jobs" && hasValue) {
+                jobs = parseJobs(argv[++i]);
+            } else if (arg == "--output" && hasValue) {
+                output = argv[++i];
+            } else if (arg.rfind("--", 0) == 0) {
+                throw std::invalid_argument("Unknown or incomplete option: " + arg);
+            } else {
+                std::vector<std::string> matches = BatchJob::expandGlob(arg);
+                if (matches.empty()) {
+                    std::cerr << "No files match " << arg << std::endl;
+                }
+                inputs.insert(inputs.end(), matches.begin(), matches.end());
+            }
+        }
+
+        if (inputs.empty()) {
+            throw std::invalid_argument("No input files.");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl << std::endl;
+        printUsage();
+        return 2;
+    }
 
-    // Print the number of observations
-    std::cout << "Number of observations: " << ts.count() << std::endl;
+    BatchJob job(inputs, operations, jobs);
+    bool succeeded = job.run();
 
-    // Calculate and print the mean
-    double meanValue;
-    if (ts.mean(&meanValue)) {
-        std::cout << "Mean price: " << meanValue << std::endl;
+    if (output.empty()) {
+        job.writeResults(std::cout);
     } else {
-        std::cerr << "Failed to calculate mean." << std::endl;
+        std::ofstream out(output);
+        if (!out.is_open()) {
+            std::cerr << "Unable to save data to file: " << output << std::endl;
+            return 1;
+        }
+        job.writeResults(out);
     }
 
-    return 0;
-}
\ No newline at end of file
+    job.printTimings(std::cerr);
+    return succeeded ? 0 : 1;
+}
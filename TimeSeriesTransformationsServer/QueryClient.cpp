@@ -0,0 +1,93 @@
+#include "QueryClient.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Connect over a Unix socket
+QueryClient QueryClient::connectUnix(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Socket path too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    QueryClient client(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (client.fd < 0 || ::connect(client.fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        throw std::runtime_error("Unable to connect to " + path + ": " + std::strerror(errno));
+    }
+    return client;
+}
+
+// Connect over TCP to the loopback interface
+QueryClient QueryClient::connectTcp(int port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+
+    QueryClient client(::socket(AF_INET, SOCK_STREAM, 0));
+    if (client.fd < 0 || ::connect(client.fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        throw std::runtime_error("Unable to connect to port " + std::to_string(port) + ": " + std::strerror(errno));
+    }
+    return client;
+}
+
+QueryClient::QueryClient(int fd) : fd(fd) {}
+
+QueryClient::QueryClient(QueryClient&& other) noexcept : fd(std::exchange(other.fd, -1)),
+    pending(std::move(other.pending)) {}
+
+QueryClient& QueryClient::operator=(QueryClient&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd = std::exchange(other.fd, -1);
+        pending = std::move(other.pending);
+    }
+    return *this;
+}
+
+QueryClient::~QueryClient() {
+    close();
+}
+
+// Send a request and read up to the end of the response line
+std::string QueryClient::request(const std::string& line) {
+    std::string message = line + '\n';
+    for (size_t sent = 0; sent < message.size();) {
+        ssize_t n = ::send(fd, message.data() + sent, message.size() - sent, 0);
+        if (n <= 0) {
+            throw std::runtime_error("Connection to the query server lost");
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    size_t newline;
+    while ((newline = pending.find('\n')) == std::string::npos) {
+        char buffer[4096];
+        ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            throw std::runtime_error("Connection to the query server lost");
+        }
+        pending.append(buffer, static_cast<size_t>(n));
+    }
+
+    std::string response = pending.substr(0, newline);
+    pending.erase(0, newline + 1);
+    return response;
+}
+
+// Close the socket, if still open, and drop any unread data
+void QueryClient::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    pending.clear();
+}
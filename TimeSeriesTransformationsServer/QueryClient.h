@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+
+// Connection to a QueryServer; sends one request line at a time and waits for its response
+class QueryClient {
+public:
+    // Connect over a Unix socket, or over TCP to a port of 127.0.0.1
+    static QueryClient connectUnix(const std::string& path);
+    static QueryClient connectTcp(int port);
+
+    QueryClient(QueryClient&& other) noexcept;
+    QueryClient& operator=(QueryClient&& other) noexcept;
+    ~QueryClient();
+
+    QueryClient(const QueryClient&) = delete;
+    QueryClient& operator=(const QueryClient&) = delete;
+
+    // Send a request and return the response line, without its newline
+    std::string request(const std::string& line);
+    // Close the connection; further requests fail
+    void close();
+
+private:
+    explicit QueryClient(int fd);
+
+    int fd;
+    std::string pending; // Received data after the last response returned
+};
@@ -0,0 +1,427 @@
+#include "QueryServer.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+#ifdef MSG_NOSIGNAL
+    const int sendFlags = MSG_NOSIGNAL;
+#else
+    const int sendFlags = 0;
+#endif
+
+    // Remove a socket file left at `address` by a server that is no longer running. Anything else at
+    // the path, including the socket of a live server, is left alone and reported
+    void removeStaleSocket(const sockaddr_un& address) {
+        const char* path = address.sun_path;
+        struct stat status;
+        if (::lstat(path, &status) < 0) {
+            if (errno == ENOENT) {
+                return;
+            }
+            throw std::runtime_error("Unable to check " + std::string(path) + ": " + std::strerror(errno));
+        }
+        if (!S_ISSOCK(status.st_mode)) {
+            throw std::runtime_error("Not replacing " + std::string(path) + ", which is not a socket.");
+        }
+
+        int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe < 0) {
+            throw std::runtime_error("Unable to create socket: " + std::string(std::strerror(errno)));
+        }
+        bool refused = ::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+            && errno == ECONNREFUSED;
+        ::close(probe);
+        if (!refused) {
+            throw std::runtime_error("Not replacing " + std::string(path) + ", which may be in use by another server.");
+        }
+        ::unlink(path);
+    }
+
+    // Split "<word> <rest>" at the first space
+    std::pair<std::string, std::string> splitWord(const std::string& text) {
+        size_t space = text.find(' ');
+        if (space == std::string::npos) {
+            return { text, "" };
+        }
+        return { text.substr(0, space), text.substr(space + 1) };
+    }
+
+    bool sendAll(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, sendFlags);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+}
+
+// Constructor
+QueryServer::QueryServer() {}
+
+// Stop serving and close every connection
+QueryServer::~QueryServer() {
+    stop();
+}
+
+// Listen on a Unix socket, replacing a socket file left at the same path by a server that has exited
+void QueryServer::listenUnix(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Socket path too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    removeStaleSocket(address);
+
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        throw std::runtime_error("Unable to create socket: " + std::string(std::strerror(errno)));
+    }
+
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listener, SOMAXCONN) < 0) {
+        std::string error = std::strerror(errno);
+        closeListener();
+        throw std::runtime_error("Unable to listen on " + path + ": " + error);
+    }
+    unixPath = path;
+}
+
+// Listen on a TCP port of the loopback interface
+void QueryServer::listenTcp(int requestedPort) {
+    listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) {
+        throw std::runtime_error("Unable to create socket: " + std::string(std::strerror(errno)));
+    }
+
+    int reuse = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(requestedPort));
+    socklen_t length = sizeof(address);
+
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listener, SOMAXCONN) < 0 ||
+        ::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+        std::string error = std::strerror(errno);
+        closeListener();
+        throw std::runtime_error("Unable to listen on port " + std::to_string(requestedPort) + ": " + error);
+    }
+    port = ntohs(address.sin_port);
+}
+
+// Get the TCP port being listened on
+int QueryServer::getPort() const {
+    return port;
+}
+
+// Accept connections, each served on its own thread, until stop()
+void QueryServer::run() {
+    if (listener < 0) {
+        throw std::runtime_error("The server is not listening.");
+    }
+
+    while (!stopping) {
+        pollfd waiting{ listener, POLLIN, 0 };
+        if (::poll(&waiting, 1, pollIntervalMs) <= 0) {
+            continue;
+        }
+
+        int connection = ::accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        connections.insert(connection);
+        std::thread([this, connection]() { serve(connection); }).detach();
+    }
+}
+
+// Accept connections on a background thread
+void QueryServer::start() {
+    acceptThread = std::thread([this]() { run(); });
+}
+
+// Stop accepting, wake the connection threads and wait for them to finish
+void QueryServer::stop() {
+    stopping = true;
+    if (acceptThread.joinable()) {
+        acceptThread.join();
+    }
+
+    std::unique_lock<std::mutex> lock(connectionMutex);
+    for (int connection : connections) {
+        ::shutdown(connection, SHUT_RDWR);
+    }
+    connectionClosed.wait(lock, [this]() { return connections.empty(); });
+    lock.unlock();
+
+    closeListener();
+}
+
+// Handle one request line, recording its latency under its command
+std::string QueryServer::handle(const std::string& request) {
+    auto start = std::chrono::steady_clock::now();
+    auto [command, arguments] = splitWord(request);
+    std::transform(command.begin(), command.end(), command.begin(), [](unsigned char c) {
+        return static_cast<char>(std::toupper(c));
+    });
+
+    static const std::set<std::string> commands = { "PING", "STATS", "LOAD", "ADD", "MEAN", "SD", "PRICE", "PRICES" };
+    std::string response;
+    if (commands.count(command) == 0) {
+        response = "ERR Unknown command: " + command;
+        command = "INVALID"; // Keep client-chosen names out of the statistics
+    } else {
+        try {
+            response = dispatch(command, arguments);
+        } catch (const std::exception& e) {
+            response = std::string("ERR ") + e.what();
+        }
+    }
+
+    double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    CommandStats& stats = commandStats[command];
+    stats.latency.add(micros);
+    ++stats.requests;
+    return response;
+}
+
+// Read request lines from a connection and answer each one
+void QueryServer::serve(int connection) {
+    std::string pending;
+    char buffer[4096];
+
+    for (;;) {
+        ssize_t n = ::recv(connection, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        pending.append(buffer, static_cast<size_t>(n));
+
+        std::string responses;
+        size_t lineStart = 0;
+        for (size_t newline; (newline = pending.find('\n', lineStart)) != std::string::npos; lineStart = newline + 1) {
+            std::string line = pending.substr(lineStart, newline - lineStart);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            responses += handle(line) + '\n';
+        }
+        pending.erase(0, lineStart);
+
+        if (!responses.empty() && !sendAll(connection, responses)) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(connectionMutex);
+    connections.erase(connection);
+    ::close(connection);
+    connectionClosed.notify_all();
+}
+
+// Run a request with a known command
+std::string QueryServer::dispatch(const std::string& command, const std::string& arguments) {
+    if (command == "PING") {
+        return "OK";
+    }
+    if (command == "STATS") {
+        return stats();
+    }
+
+    auto [name, rest] = splitWord(arguments);
+    if (name.empty()) {
+        throw std::invalid_argument("Missing series name");
+    }
+
+    if (command == "LOAD") {
+        return load(name, rest);
+    }
+    if (command == "ADD") {
+        return add(name, rest);
+    }
+    return query(name, command, rest);
+}
+
+// Answer a query from the cache, from an identical query already running, or by computing it
+std::string QueryServer::query(const std::string& name, const std::string& command, const std::string& arguments) {
+    std::string key = command + ' ' + arguments;
+    std::shared_ptr<const TimeSeriesTransformations> data;
+    uint64_t version;
+    std::promise<std::string> promise;
+
+    {
+        std::unique_lock<std::mutex> lock(seriesMutex);
+        auto found = series.find(name);
+        if (found == series.end()) {
+            throw std::invalid_argument("Unknown series: " + name);
+        }
+        Series& entry = found->second;
+
+        auto cached = entry.results.find(key);
+        if (cached != entry.results.end()) {
+            std::string result = cached->second;
+            lock.unlock();
+            std::lock_guard<std::mutex> statsLock(statsMutex);
+            ++cacheHits;
+            return result;
+        }
+
+        auto running = entry.inFlight.find(key);
+        if (running != entry.inFlight.end()) {
+            std::shared_future<std::string> result = running->second;
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> statsLock(statsMutex);
+                ++batched;
+            }
+            return result.get();
+        }
+
+        entry.inFlight[key] = promise.get_future().share();
+        data = entry.data;
+        version = entry.version;
+    }
+
+    std::string result;
+    try {
+        result = compute(*data, command, arguments);
+    } catch (const std::exception& e) {
+        result = std::string("ERR ") + e.what();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(seriesMutex);
+        auto found = series.find(name);
+        if (found != series.end() && found->second.version == version) {
+            Series& entry = found->second;
+            entry.inFlight.erase(key);
+            if (entry.results.size() >= maxCachedResults) {
+                entry.results.clear();
+            }
+            entry.results[key] = result;
+        }
+    }
+    promise.set_value(result);
+    return result;
+}
+
+// Compute a query on a snapshot of a series
+std::string QueryServer::compute(const TimeSeriesTransformations& ts, const std::string& command,
+    const std::string& arguments) const {
+    double value;
+
+    if (command == "MEAN") {
+        return ts.mean(&value) ? "OK " + TimeSeriesTransformations::formatDouble(value) : "ERR Empty series";
+    }
+    if (command == "SD") {
+        return ts.standardDeviation(&value) ? "OK " + TimeSeriesTransformations::formatDouble(value) : "ERR Too few prices";
+    }
+    if (command == "PRICE") {
+        return ts.getPriceAtDate(arguments, &value)
+            ? "OK " + TimeSeriesTransformations::formatDouble(value) : "ERR No price at " + arguments;
+    }
+
+    // PRICES
+    std::string result = "OK ";
+    std::vector<double> prices = ts.viewOnDate(arguments).getPrice();
+    for (size_t i = 0; i < prices.size(); ++i) {
+        result += (i > 0 ? "," : "") + TimeSeriesTransformations::formatDouble(prices[i]);
+    }
+    return result;
+}
+
+// Load a CSV file and make it the new version of a series
+std::string QueryServer::load(const std::string& name, const std::string& path) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    auto data = std::make_shared<const TimeSeriesTransformations>(path);
+    publish(name, data);
+    return "OK " + std::to_string(data->count());
+}
+
+// Add a share price; the new version shares its storage with the old one until the change
+std::string QueryServer::add(const std::string& name, const std::string& arguments) {
+    auto [priceText, datetime] = splitWord(arguments);
+    double price = std::stod(priceText);
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    std::shared_ptr<const TimeSeriesTransformations> current;
+    {
+        std::lock_guard<std::mutex> seriesLock(seriesMutex);
+        auto found = series.find(name);
+        if (found == series.end()) {
+            throw std::invalid_argument("Unknown series: " + name);
+        }
+        current = found->second.data;
+    }
+
+    auto changed = std::make_shared<TimeSeriesTransformations>(*current);
+    changed->addASharePrice(datetime, price);
+    publish(name, changed);
+    return "OK " + std::to_string(changed->count());
+}
+
+// Replace a series and drop the results cached for its previous version
+void QueryServer::publish(const std::string& name, std::shared_ptr<const TimeSeriesTransformations> data) {
+    std::lock_guard<std::mutex> lock(seriesMutex);
+    Series& entry = series[name];
+    entry.data = std::move(data);
+    ++entry.version;
+    entry.results.clear();
+    entry.inFlight.clear(); // Their waiters hold the futures; results for the old version are not cached
+}
+
+// Summarize request counts, cache use and latency percentiles per command
+std::string QueryServer::stats() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    std::ostringstream out;
+    size_t requests = 0;
+    for (const auto& command : commandStats) {
+        requests += command.second.requests;
+    }
+
+    out << "OK requests=" << requests << " cacheHits=" << cacheHits << " batched=" << batched;
+    for (const auto& command : commandStats) {
+        const TDigest& latency = command.second.latency;
+        out << ' ' << command.first << "(n=" << command.second.requests
+            << " p50=" << latency.quantile(0.5) << "us p90=" << latency.quantile(0.9)
+            << "us p99=" << latency.quantile(0.99) << "us)";
+    }
+    return out.str();
+}
+
+// Close the listening socket and remove its socket file
+void QueryServer::closeListener() {
+    if (listener >= 0) {
+        ::close(listener);
+        listener = -1;
+    }
+    if (!unixPath.empty()) {
+        ::unlink(unixPath.c_str());
+        unixPath.clear();
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "TimeSeriesTransformations.h"
+#include "TDigest.h"
+
+// Local query server keeping loaded series resident. Clients connect over a Unix socket or TCP on
+// 127.0.0.1 and send one request per line; each gets one response line, "OK <result>" or
+// "ERR <message>":
+//   LOAD <series> <path>            Load (or reload) a CSV file as <series>
+//   ADD <series> <price> <datetime> Add a share price
+//   MEAN <series>                   Mean price
+//   SD <series>                     Standard deviation of the prices
+//   PRICE <series> <datetime>       Price at a date and time
+//   PRICES <series> <date>          Comma-separated prices on a date
+//   STATS                           Request counts, cache hits and latency percentiles
+//   PING
+// Query results are cached per series version, and identical queries arriving while one is being
+// computed wait for its result instead of computing it again.
+class QueryServer {
+public:
+    QueryServer();
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    // Listen on a Unix socket, or on a TCP port of 127.0.0.1 (0 picks a free port)
+    void listenUnix(const std::string& path);
+    void listenTcp(int port);
+    int getPort() const;
+
+    // Accept connections until stop(), on this thread or a background one
+    void run();
+    void start();
+    void stop();
+
+    // Handle one request line, as if it came from a client
+    std::string handle(const std::string& request);
+
+private:
+    struct Series {
+        std::shared_ptr<const TimeSeriesTransformations> data; // Replaced, never modified
+        uint64_t version = 0;
+        std::unordered_map<std::string, std::string> results; // Cached responses for this version
+        std::unordered_map<std::string, std::shared_future<std::string>> inFlight;
+    };
+
+    struct CommandStats {
+        TDigest latency; // Microseconds
+        size_t requests = 0;
+    };
+
+    static constexpr size_t maxCachedResults = 4096; // Per series; the cache is dropped when full
+    static constexpr int pollIntervalMs = 100; // How often the accept loop checks for stop()
+
+    int listener = -1;
+    int port = 0;
+    std::string unixPath;
+    std::atomic<bool> stopping{false};
+    std::thread acceptThread;
+
+    std::mutex connectionMutex;
+    std::condition_variable connectionClosed;
+    std::set<int> connections; // Open connections, each served by a detached thread
+
+    std::mutex seriesMutex;
+    std::map<std::string, Series> series;
+    std::mutex writeMutex; // Serializes changes to the series
+
+    std::mutex statsMutex;
+    std::map<std::string, CommandStats> commandStats;
+    size_t cacheHits = 0;
+    size_t batched = 0;
+
+    void serve(int connection);
+    std::string dispatch(const std::string& command, const std::string& arguments);
+    std::string query(const std::string& name, const std::string& command, const std::string& arguments);
+    std::string compute(const TimeSeriesTransformations& ts, const std::string& command,
+        const std::string& arguments) const;
+    std::string load(const std::string& name, const std::string& path);
+    std::string add(const std::string& name, const std::string& arguments);
+    void publish(const std::string& name, std::shared_ptr<const TimeSeriesTransformations> data);
+    std::string stats();
+    void closeListener();
+};
@@ -0,0 +1,74 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <pthread.h>
+#include "QueryServer.h"
+
+namespace {
+    void printUsage() {
+        std::cout <<
+            "Usage: TimeSeriesTransformationsServer (--unix <path> | --port <port>) [--load <series>=<csv>]...\n"
+            "\n"
+            "Serves queries on resident series over a Unix socket or TCP on 127.0.0.1 until interrupted.\n"
+            "Send one request per line, e.g. \"LOAD shares Problem3_DATA.csv\", \"MEAN shares\",\n"
+            "\"PRICE shares 2021-04-23 13:36:50\", \"PRICES shares 2021-04-23\" or \"STATS\".\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Handle SIGINT and SIGTERM with sigwait below; block them before any thread starts so every
+    // thread inherits the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    QueryServer server;
+    bool listening = false;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (arg == "--unix" && hasValue) {
+                server.listenUnix(argv[++i]);
+                listening = true;
+            } else if (arg == "--port" && hasValue) {
+                server.listenTcp(std::stoi(argv[++i]));
+                listening = true;
+            } else if (arg == "--load" && hasValue) {
+                std::string load = argv[++i];
+                size_t equals = load.find('=');
+                if (equals == std::string::npos) {
+                    throw std::invalid_argument("Expected --load <series>=<csv>: " + load);
+                }
+                std::cout << server.handle("LOAD " + load.substr(0, equals) + ' ' + load.substr(equals + 1))
+                          << std::endl;
+            } else {
+                printUsage();
+                return arg == "--help" || arg == "-h" ? 0 : 2;
+            }
+        }
+
+        if (!listening) {
+            printUsage();
+            return 2;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    server.start();
+    std::cout << "Listening" << (server.getPort() ? " on port " + std::to_string(server.getPort()) : "")
+              << "; interrupt to stop." << std::endl;
+
+    int received;
+    sigwait(&signals, &received);
+    server.stop();
+    std::cout << server.handle("STATS") << std::endl;
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "QueryClient.h"
+#include "QueryServer.h"
+#include "TDigest.h"
+#include "TimeSeriesTransformations.h"
+
+// Load generator for the query server: several clients send a mix of MEAN, SD, PRICE and PRICES
+// queries (and optionally ADDs) and the client-side latency percentiles and throughput are reported.
+// Without --unix or --port it starts a server in this process on a temporary Unix socket.
+int main(int argc, char* argv[]) {
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::string csv = "Problem3_DATA.csv";
+    std::string socketPath;
+    int port = 0;
+    size_t clients = 8;
+    size_t requestsPerClient = 2000;
+    size_t writeEvery = 0; // Send an ADD every this many requests per client (0: never)
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            csv = argv[i + 1];
+        } else if (arg == "--unix") {
+            socketPath = argv[i + 1];
+        } else if (arg == "--port") {
+            port = std::stoi(argv[i + 1]);
+        } else if (arg == "--clients") {
+            clients = std::stoul(argv[i + 1]);
+        } else if (arg == "--requests") {
+            requestsPerClient = std::stoul(argv[i + 1]);
+        } else if (arg == "--write-every") {
+            writeEvery = std::stoul(argv[i + 1]);
+        } else {
+            std::cerr << "Usage: TimeSeriesTransformationsServerBenchmark [--csv <file>] [--unix <path> | --port <port>]"
+                      << " [--clients <n>] [--requests <n per client>] [--write-every <n>]" << std::endl;
+            return 2;
+        }
+    }
+
+    // Queries use dates taken from the data
+    TimeSeriesTransformations local(csv);
+    std::vector<int> times = local.getTime();
+    if (times.empty()) {
+        std::cerr << "No data in " << csv << std::endl;
+        return 1;
+    }
+    std::vector<std::string> queries = { "MEAN bench", "SD bench" };
+    for (size_t i = 0; i < 16; ++i) {
+        std::string dateTime = TimeSeriesTransformations::unixToDateTime(times[i * (times.size() - 1) / 15]);
+        queries.push_back("PRICE bench " + dateTime);
+        queries.push_back("PRICES bench " + dateTime.substr(0, 10));
+    }
+
+    QueryServer server;
+    bool inProcess = socketPath.empty() && port == 0;
+    if (inProcess) {
+        socketPath = "/tmp/tst-query-server-" + std::to_string(::getpid()) + ".sock";
+        server.listenUnix(socketPath);
+        server.start();
+    }
+    auto connect = [&]() {
+        return port ? QueryClient::connectTcp(port) : QueryClient::connectUnix(socketPath);
+    };
+
+    // Load the series and check an answer against the library
+    QueryClient control = connect();
+    std::string loaded = control.request("LOAD bench " + csv);
+    double expected;
+    local.mean(&expected);
+    std::string mean = control.request("MEAN bench");
+    if (loaded.rfind("OK", 0) != 0 || mean.rfind("OK ", 0) != 0 || std::stod(mean.substr(3)) != expected) {
+        std::cerr << "Unexpected responses: " << loaded << " / " << mean << std::endl;
+        return 1;
+    }
+
+    std::mutex latencyMutex;
+    TDigest latency;
+    std::atomic<size_t> errors(0);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            QueryClient client = connect();
+            TDigest clientLatency;
+            for (size_t r = 0; r < requestsPerClient; ++r) {
+                std::string request = writeEvery && r % writeEvery == writeEvery - 1
+                    ? "ADD bench 50 " + TimeSeriesTransformations::unixToDateTime(times.back() + static_cast<int>(c * requestsPerClient + r + 1))
+                    : queries[(c + r) % queries.size()];
+
+                auto sent = std::chrono::steady_clock::now();
+                std::string response = client.request(request);
+                clientLatency.add(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count());
+                if (response.rfind("OK", 0) != 0) {
+                    ++errors;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(latencyMutex);
+            latency.merge(clientLatency);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t total = clients * requestsPerClient;
+    std::cout << "Requests: " << total << " from " << clients << " clients in " << seconds << " s ("
+              << total / seconds << " requests/s), " << errors << " errors" << std::endl;
+    std::cout << "Client latency: p50 " << latency.quantile(0.5) << " us, p90 " << latency.quantile(0.9)
+              << " us, p99 " << latency.quantile(0.99) << " us, max " << latency.max() << " us" << std::endl;
+    std::cout << "Server: " << control.request("STATS") << std::endl;
+
+    if (inProcess) {
+        control.close(); // Close the control connection before stopping
+        server.stop();
+    }
+    return errors == 0 ? 0 : 1;
+}